@@ -0,0 +1,294 @@
+/**
+ * @file        asid.c
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        18 October, 2026
+ * @brief       Address Space Identifiers Allocator
+*/
+
+
+/* Includes ----------------------------------------------- */
+#include <asid.h>
+#include <arch.h>
+#include <asm.h>
+#include <klock.h>
+
+
+/* Private types ------------------------------------------ */
+
+
+
+/* Private constants -------------------------------------- */
+
+#define ASID_FIRST_GENERATION	(1UL << ASID_BITS)
+#define ASID_COUNT				(1UL << ASID_BITS)
+
+
+/* Private macros ----------------------------------------- */
+
+#define ASID_GENERATION(a)		((a) & ~ASID_MASK)
+#define ASID_CURRENT(a)			(ASID_GENERATION(a) == asids.generation)
+
+
+/* Private variables -------------------------------------- */
+
+static struct
+{
+	klock_t				lock;
+	volatile uint32_t	generation;
+	uint32_t			next;
+	uint32_t			map[ASID_COUNT >> 5];
+	// ASID in use by each cpu, kept across a rollover
+	volatile uint32_t	active[MAX_CPUS];
+	uint32_t			reserved[MAX_CPUS];
+	// Cpus that have to invalidate their TLB before using the new generation
+	volatile uint32_t	flush;
+}asids;
+
+
+/* Private function prototypes ---------------------------- */
+
+static inline bool_t AsidMapTest(uint32_t hw)
+{
+	return ((asids.map[hw >> 5] & (1UL << (hw & 0x1F))) != 0);
+}
+
+static inline void AsidMapSet(uint32_t hw)
+{
+	asids.map[hw >> 5] |= (1UL << (hw & 0x1F));
+}
+
+static inline void AsidMapClear(uint32_t hw)
+{
+	asids.map[hw >> 5] &= ~(1UL << (hw & 0x1F));
+}
+
+/*
+ * Start a new generation. The ASIDs running on the cpus stay reserved so those
+ * address spaces can move to the new generation without changing ASID
+ */
+static void AsidRollover()
+{
+	uint32_t cpu;
+	uint32_t i;
+
+	asids.generation += ASID_FIRST_GENERATION;
+	// Pairs with the barrier in AsidGet fast path
+	dmb();
+
+	for(i = 0; i < (ASID_COUNT >> 5); i++)
+	{
+		asids.map[i] = 0x0;
+	}
+	AsidMapSet(0);
+
+	for(cpu = 0; cpu < MAX_CPUS; cpu++)
+	{
+		uint32_t active = asids.active[cpu];
+
+		// Zero until the cpu gets an ASID again, a later rollover then knows
+		// the cpu is still running with the one reserved now
+		asids.active[cpu] = 0;
+
+		// A cpu that didn't switch since the last rollover keeps its reserved ASID
+		if(active != 0)
+		{
+			asids.reserved[cpu] = active;
+		}
+
+		if(asids.reserved[cpu] != 0)
+		{
+			AsidMapSet(asids.reserved[cpu] & ASID_MASK);
+		}
+	}
+
+	asids.next = 1;
+	asids.flush = ((1UL << MAX_CPUS) - 1);
+}
+
+static uint32_t AsidNew(asid_t asid)
+{
+	uint32_t hw = (asid & ASID_MASK);
+
+	if(asid != 0)
+	{
+		uint32_t value = (asids.generation | hw);
+		bool_t reserved = FALSE;
+		uint32_t cpu;
+
+		// Was running during the rollover, the ASID was kept for it. Every cpu
+		// running the address space reserved it, all of them move along
+		for(cpu = 0; cpu < MAX_CPUS; cpu++)
+		{
+			if(asids.reserved[cpu] == asid)
+			{
+				asids.reserved[cpu] = value;
+				reserved = TRUE;
+			}
+		}
+
+		if(reserved)
+		{
+			return value;
+		}
+
+		// Try to keep the same ASID
+		if(!AsidMapTest(hw))
+		{
+			AsidMapSet(hw);
+			return (asids.generation | hw);
+		}
+	}
+
+	uint32_t tries;
+
+	for(tries = 0; tries < 2; tries++)
+	{
+		for(; asids.next < ASID_COUNT; asids.next++)
+		{
+			if(!AsidMapTest(asids.next))
+			{
+				hw = asids.next++;
+				AsidMapSet(hw);
+				return (asids.generation | hw);
+			}
+		}
+
+		AsidRollover();
+	}
+
+	// More cpus than ASIDs, can't happen
+	return (asids.generation | ASID_MASK);
+}
+
+
+/* Private functions -------------------------------------- */
+
+/**
+ * AsidInit Implementation (See header file for description)
+*/
+void AsidInit(void)
+{
+	uint32_t cpu;
+
+	KlockInit(&asids.lock);
+	KlockName(&asids.lock, "asid");
+
+	asids.generation = ASID_FIRST_GENERATION;
+	asids.next = 1;
+	asids.flush = 0;
+
+	for(cpu = 0; cpu < MAX_CPUS; cpu++)
+	{
+		asids.active[cpu] = 0;
+		asids.reserved[cpu] = 0;
+	}
+
+	// ASID 0 is used by the kernel
+	AsidMapSet(0);
+}
+
+/**
+ * AsidGet Implementation (See header file for description)
+*/
+uint32_t AsidGet(asid_t *asid)
+{
+	uint32_t cpu = RUNNING_CPU;
+	asid_t value = *asid;
+
+	// Fast path, no lock taken when the ASID is from the running generation
+	if((value != 0) && ASID_CURRENT(value) && !(asids.flush & (1UL << cpu)))
+	{
+		asids.active[cpu] = value;
+		// A rollover either sees this cpu active ASID or we see the new generation
+		dmb();
+
+		if(ASID_CURRENT(value))
+		{
+			return (value & ASID_MASK);
+		}
+	}
+
+	uint32_t status;
+	Klock(&asids.lock, &status);
+
+	value = *asid;
+
+	if((value == 0) || !ASID_CURRENT(value))
+	{
+		value = AsidNew(value);
+		*asid = value;
+
+		// Branch predictor entries can belong to the ASID previous owner, Inner Shareable
+		asm volatile("mcr p15, 0, %[zero], c7, c1, 6" : : [zero] "r" (0));
+	}
+
+	if(asids.flush & (1UL << cpu))
+	{
+		asids.flush &= ~(1UL << cpu);
+		// Invalidate entire unified TLB and branch predictor, local to this cpu
+		asm volatile("mcr p15, 0, %[zero], c8, c7, 0" : : [zero] "r" (0));
+		asm volatile("mcr p15, 0, %[zero], c7, c5, 6" : : [zero] "r" (0));
+		dsb();
+	}
+
+	asids.active[cpu] = value;
+
+	Kunlock(&asids.lock, &status);
+
+	return (value & ASID_MASK);
+}
+
+/**
+ * AsidHardware Implementation (See header file for description)
+*/
+uint32_t AsidHardware(asid_t *asid)
+{
+	uint32_t hw = 0;
+	uint32_t cpu;
+
+	uint32_t status;
+	Klock(&asids.lock, &status);
+
+	asid_t value = *asid;
+
+	if((value != 0) && ASID_CURRENT(value))
+	{
+		hw = (value & ASID_MASK);
+	}
+	else if(value != 0)
+	{
+		// Kept for a cpu that runs it since the rollover, its TLB entries are still
+		// live there until the cpu switches to the new generation
+		for(cpu = 0; cpu < MAX_CPUS; cpu++)
+		{
+			if(asids.reserved[cpu] == value)
+			{
+				hw = (value & ASID_MASK);
+				break;
+			}
+		}
+	}
+
+	Kunlock(&asids.lock, &status);
+
+	return hw;
+}
+
+/**
+ * AsidRelease Implementation (See header file for description)
+*/
+void AsidRelease(asid_t *asid)
+{
+	uint32_t status;
+	Klock(&asids.lock, &status);
+
+	if((*asid != 0) && ASID_CURRENT(*asid))
+	{
+		AsidMapClear(*asid & ASID_MASK);
+	}
+
+	*asid = 0;
+
+	Kunlock(&asids.lock, &status);
+}
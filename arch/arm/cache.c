@@ -15,14 +15,36 @@ static uint32_t get_ccsidr()
 	return ccsidr;
 }
 
-void FlushDcacheRange(ptr_t addr, size_t size)
+static uint32_t get_line_len()
 {
 	uint32_t ccsidr = get_ccsidr();
 	uint32_t line_len = ((ccsidr & CCSIDR_LINE_SIZE_MASK) >> CCSIDR_LINE_SIZE_OFFSET) + 2;
 	/* Converting from words to bytes */
 	line_len += 2;
 	/* converting from log2(linelen) to linelen */
-	line_len = 1 << line_len;
+	return (1 << line_len);
+}
+
+void CleanDcacheRange(ptr_t addr, size_t size)
+{
+	uint32_t line_len = get_line_len();
+
+	// Align start to cache line boundary
+	uint32_t mva = ((uint32_t)addr & ~(line_len - 1));
+	uint32_t stop = (uint32_t)addr + size;
+
+	for (; mva < stop; mva += line_len)
+	{
+		/* DCCMVAC - Clean data cache by MVA to PoC */
+		asm volatile ("mcr p15, 0, %0, c7, c10, 1" : : "r" (mva));
+	}
+
+	dsb();
+}
+
+void FlushDcacheRange(ptr_t addr, size_t size)
+{
+	uint32_t line_len = get_line_len();
 
 	// Align start to cache line boundary
 	uint32_t mva = ((uint32_t)addr & ~(line_len - 1));
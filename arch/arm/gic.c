@@ -169,23 +169,37 @@ int32_t InterruptSetPriority(uint32_t irq, uint32_t priority)
 */
 void InterruptSetTarget(uint32_t irq, uint32_t target, uint32_t set)
 {
-	uint32_t word, bit_shift, temp;
+	// Target registers are byte accessible, don't touch the other 3 interrupts in the word
+	volatile uint8_t *targets = (volatile uint8_t*)gicDistributer->target;
 
-    // There are 4 interrupt target registers per word
-    word = irq / 4;
-    bit_shift = (irq % 4) * 8;
-    target = (1 << target) << bit_shift;
-
-    temp = gicDistributer->target[word];
     if (set)
     {
-        temp |= target;
+        targets[irq] |= (uint8_t)(1 << target);
     }
     else
     {
-        temp &= ~target;
+        targets[irq] &= (uint8_t)~(1 << target);
     }
-    gicDistributer->target[word] = temp;			// Interrupt Processor Target Registers
+}
+
+/**
+ * InterruptSetTargets Implementation (See header file for description)
+*/
+void InterruptSetTargets(uint32_t irq, uint32_t mask)
+{
+	volatile uint8_t *targets = (volatile uint8_t*)gicDistributer->target;
+
+	targets[irq] = (uint8_t)(mask & 0xFF);
+}
+
+/**
+ * InterruptGetTargets Implementation (See header file for description)
+*/
+uint32_t InterruptGetTargets(uint32_t irq)
+{
+	volatile uint8_t *targets = (volatile uint8_t*)gicDistributer->target;
+
+	return (uint32_t)targets[irq];
 }
 
 
@@ -201,7 +215,9 @@ void InterruptEnable(uint32_t irq)
 	irq %= 32;
 	irq = 1 << irq;
 
-	gicDistributer->eset[word] |= irq;
+	// Writing zeros has no effect, a read-modify-write could enable interrupts
+	// another cpu has just disabled
+	gicDistributer->eset[word] = irq;
 }
 
 /**
@@ -216,7 +232,7 @@ void InterruptDisable(uint32_t irq)
 	irq %= 32;
 	irq = 1 << irq;
 
-	gicDistributer->eclear[word] |= irq;
+	gicDistributer->eclear[word] = irq;
 }
 
 void InterruptGenerate(uint32_t irq, uint32_t cpu)
@@ -63,6 +63,10 @@ typedef struct {
 #define SYSTIMER				TIMER_0
 #define SYSTIMER_IRQ			TIMER0_IRQ
 
+// Generic timer non-secure physical timer, private to each cpu
+#define CNTP_IRQ				30
+#define CNTP_CTL_ENABLE			(1 << 0)
+
 /* Private macros ----------------------------------------- */
 
 
@@ -127,6 +131,49 @@ int32_t SystemTimerIrq()
 	return SYSTIMER_IRQ;
 }
 
+uint64_t SystemCounterRead()
+{
+	uint64_t count;
+
+	// Generic timer physical count (CNTPCT), started by the boot loader
+	asm volatile ("isb\n\t"
+				  "mrrc p15, 0, %Q0, %R0, c14" : "=r" (count));
+
+	return count;
+}
+
+uint32_t SystemCounterFreq()
+{
+	uint32_t freq;
+
+	// CNTFRQ
+	asm volatile ("mrc p15, 0, %0, c14, c0, 0" : "=r" (freq));
+
+	return freq;
+}
+
+void SystemDeadlineStart(void* (*handler)(void*, uint32_t))
+{
+	SystemDeadlineClear();
+	InterruptAttach(CNTP_IRQ, 10, handler, NULL);
+}
+
+void SystemDeadlineSet(uint64_t deadline)
+{
+	// CNTP_CVAL, the timer condition is met while the count is at or past it
+	asm volatile ("mcrr p15, 2, %Q0, %R0, c14" : : "r" (deadline));
+	// CNTP_CTL
+	asm volatile ("mcr p15, 0, %0, c14, c2, 1\n\t"
+				  "isb" : : "r" (CNTP_CTL_ENABLE));
+}
+
+void SystemDeadlineClear()
+{
+	// The interrupt is level triggered, it only goes away with the timer disabled
+	asm volatile ("mcr p15, 0, %0, c14, c2, 1\n\t"
+				  "isb" : : "r" (0));
+}
+
 int32_t TimerInit(uint32_t timerId, uint32_t loadValue, uint32_t config)
 {
 	if(h3Timers == NULL)
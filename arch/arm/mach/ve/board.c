@@ -34,6 +34,7 @@
 
 #define PRIV_TIMERS				(2)
 #define PRIV_TIMER_OFFSET		(0x0600)
+#define GLOBAL_TIMER_OFFSET		(0x0200)
 
 /* Private macros ----------------------------------------- */
 
@@ -193,3 +194,8 @@ vaddr_t BoardPrivateTimers()
 {
 	return board_setup.timer.base;
 }
+
+vaddr_t BoardGlobalTimer()
+{
+	return (vaddr_t)((uint32_t)board_setup.gic.base + GLOBAL_TIMER_OFFSET);
+}
@@ -22,6 +22,18 @@ typedef struct
 	volatile uint32_t pt_interrupt_status_reg;
 }timer_t;
 
+typedef struct
+{
+	volatile uint32_t gt_counter_low;
+	volatile uint32_t gt_counter_high;
+	volatile uint32_t gt_control_reg;
+	// Banked per cpu
+	volatile uint32_t gt_interrupt_status_reg;
+	volatile uint32_t gt_comparator_low;
+	volatile uint32_t gt_comparator_high;
+	volatile uint32_t gt_auto_increment;
+}gtimer_t;
+
 
 /* Private constants -------------------------------------- */
 
@@ -36,6 +48,15 @@ typedef struct
 #define TIMER_ENABLE          	(1 << 0)
 #define TIMER_INTERRUPT_CLEAR 	(1 << 0)
 
+#define GTIMER_INTERRUPT		27
+
+#define GTIMER_COMP_ENABLE		(1 << 1)
+#define GTIMER_IT_ENABLE		(1 << 2)
+#define GTIMER_EVENT_CLEAR		(1 << 0)
+
+// Private timer counts microseconds with the 256 prescaler, the global timer runs without it
+#define GLOBAL_TIMER_HZ			(256000000)
+
 
 /* Private macros ----------------------------------------- */
 
@@ -47,6 +68,8 @@ typedef struct
 
 extern vaddr_t BoardPrivateTimers();
 
+extern vaddr_t BoardGlobalTimer();
+
 
 /* Private functions -------------------------------------- */
 
@@ -54,6 +77,10 @@ void SystemTickStart(uint32_t usec, void* (*handler)(void*, uint32_t))
 {
 	SytemTimerInit(AUTO_RELOAD_TIMER, usec);
 	InterruptAttach(SystemTimerIrq(), 10, handler, NULL);
+
+	// Start the global timer, only its counter is used
+	gtimer_t *gtimer = (gtimer_t*)BoardGlobalTimer();
+	gtimer->gt_control_reg |= TIMER_ENABLE;
 }
 
 void SytemTimerInit(uint32_t mode, uint32_t u_sec)
@@ -103,3 +130,49 @@ int32_t SystemTimerIrq()
 {
 	return TIMER_INTERRUPT;
 }
+
+uint64_t SystemCounterRead()
+{
+	gtimer_t *gtimer = (gtimer_t*)BoardGlobalTimer();
+	uint32_t high, low;
+
+	// Read the high word again in case the low word wrapped in between
+	do
+	{
+		high = gtimer->gt_counter_high;
+		low = gtimer->gt_counter_low;
+	}while(high != gtimer->gt_counter_high);
+
+	return (((uint64_t)high << 32) | low);
+}
+
+uint32_t SystemCounterFreq()
+{
+	return GLOBAL_TIMER_HZ;
+}
+
+void SystemDeadlineStart(void* (*handler)(void*, uint32_t))
+{
+	SystemDeadlineClear();
+	InterruptAttach(GTIMER_INTERRUPT, 10, handler, NULL);
+}
+
+void SystemDeadlineSet(uint64_t deadline)
+{
+	gtimer_t *gtimer = (gtimer_t*)BoardGlobalTimer();
+
+	// The comparator can't change while enabled. From r2p0 the event is raised
+	// when the counter is greater or equal, a past deadline fires right away
+	gtimer->gt_control_reg &= ~GTIMER_COMP_ENABLE;
+	gtimer->gt_comparator_low = (uint32_t)deadline;
+	gtimer->gt_comparator_high = (uint32_t)(deadline >> 32);
+	gtimer->gt_control_reg |= (GTIMER_COMP_ENABLE | GTIMER_IT_ENABLE);
+}
+
+void SystemDeadlineClear()
+{
+	gtimer_t *gtimer = (gtimer_t*)BoardGlobalTimer();
+
+	gtimer->gt_control_reg &= ~(GTIMER_COMP_ENABLE | GTIMER_IT_ENABLE);
+	gtimer->gt_interrupt_status_reg = GTIMER_EVENT_CLEAR;
+}
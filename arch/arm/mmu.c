@@ -9,6 +9,7 @@
 
 /* Includes ----------------------------------------------- */
 #include <mmu.h>
+#include <asid.h>
 #include <cache.h>
 #include <asm.h>
 
@@ -24,10 +25,7 @@ typedef ptr_t	pgt2_t;
 
 /* Private constants -------------------------------------- */
 
-//PAGE_SIZE is defined in the mmu.h
-#define LARGE_PAGE_SIZE		0X10000
-#define SECTION_SIZE		0x100000
-#define LARGE_SECTION_SIZE	0x1000000
+//PAGE_SIZE and the large page and section sizes are defined in the mmu.h
 
 #define PAGE_SHIFT			(12)
 #define SUPERSECTION_SHIFT	(24)
@@ -43,6 +41,14 @@ typedef ptr_t	pgt2_t;
 #define L2PGT_SIZE		1024
 #define L2PGT_ALIGN		1024
 
+// User L1 entries, each one can point to a L2 page table
+#define L1PGT_USR_ENTRIES	(L1PGT_USR_SIZE >> 2)
+// The page after the user L1 page table keeps track of its L2 page tables
+#define L2MAP_SIZE			PAGE_SIZE
+
+// Above this number of pages the TLB is invalidated for the whole address space
+#define TLB_RANGE_MAX_PAGES	(64)
+
 // L1 Page Table Entries
 #define FAULT			(0x0)
 #define L2_PGT			(0x1)
@@ -78,6 +84,8 @@ typedef ptr_t	pgt2_t;
 
 /* Private macros ----------------------------------------- */
 
+#define L2MAP_GET(pgt)			((l2map_t*)((uint32_t)(pgt) + L1PGT_USR_SIZE))
+
 #define SHARABLE_SET(x)			(x |= MMU_S)
 #define LOCAL_SET(x)			(x |= MMU_nG)
 #define NO_EXEC_SET(x)			(x |= MMU_XN)
@@ -123,6 +131,16 @@ typedef ptr_t	pgt2_t;
 #define SHIFT_1MB(x)		(x >>= 20)
 
 
+/* Private types ------------------------------------------ */
+
+// L2 page tables in use by a user address space, one bit per L1 entry
+typedef struct
+{
+	uint32_t	count;
+	uint32_t	bitmap[L1PGT_USR_ENTRIES >> 5];
+}l2map_t;
+
+
 /* Private variables -------------------------------------- */
 
 static ulong_t cacheCfgs[] =
@@ -152,6 +170,9 @@ static struct
 	klock_t lock;
 }l2Allocator;
 
+// Kernel L1 page table physical address, it doesn't have a L2 tracking map
+static uint32_t kernelL1 = 0;
+
 /* Private function prototypes ---------------------------- */
 
 static pgt2_t L2PageTableAlloc(void)
@@ -234,6 +255,78 @@ inline static paddr_t PageTablePhysicalAddress(ptr_t pgt)
 	return (paddr_t)MemoryL2P(pgt);
 }
 
+/*
+ * Only user page tables track their L2 page tables. The kernel page table
+ * is also used for the low entries while the boot identity map is removed
+ */
+static l2map_t *L2MapGet(pgt_t pgt, uint32_t entry)
+{
+	if((entry >= L1PGT_USR_ENTRIES) || ((uint32_t)pgt == kernelL1))
+	{
+		return NULL;
+	}
+
+	if((uint32_t)PageTablePhysicalAddress((ptr_t)pgt) == kernelL1)
+	{
+		return NULL;
+	}
+
+	return L2MAP_GET(pgt);
+}
+
+static void L2MapSet(pgt_t pgt, uint32_t entry)
+{
+	l2map_t *l2map = L2MapGet(pgt, entry);
+
+	if(l2map != NULL)
+	{
+		l2map->bitmap[entry >> 5] |= (1UL << (entry & 0x1F));
+		l2map->count++;
+	}
+}
+
+static void L2MapClear(pgt_t pgt, uint32_t entry)
+{
+	l2map_t *l2map = L2MapGet(pgt, entry);
+
+	if(l2map != NULL)
+	{
+		l2map->bitmap[entry >> 5] &= ~(1UL << (entry & 0x1F));
+		l2map->count--;
+	}
+}
+
+/*
+ * The kernel page table walks don't look up the data cache, clean the L1 entries
+ * of the range and the whole L2 page tables they point to. A L2 page table can
+ * be fresh from the allocator so none of its entries can be left in the cache
+ */
+static void KernelPageTableClean(uint32_t start, uint32_t end)
+{
+	ulong_t *pgt = (ulong_t*)MemoryP2L((ptr_t)kernelL1);
+
+	if(pgt == NULL)
+	{
+		// Early boot, the page table is not in the direct memory yet
+		FlushDcache();
+		return;
+	}
+
+	uint32_t first = (start >> 20);
+	uint32_t last = ((end - 1) >> 20);
+	uint32_t entry;
+
+	for(entry = first; entry <= last; entry++)
+	{
+		if(pgt[entry] & L2_PGT)
+		{
+			CleanDcacheRange(PageTableVirtualAddress((ptr_t)(pgt[entry] & 0xfffffc00)), L2PGT_SIZE);
+		}
+	}
+
+	CleanDcacheRange((ptr_t)&pgt[first], ((last - first + 1) << 2));
+}
+
 inline static ulong_t GetPteFlags(ulong_t cpolicy, ulong_t apolicy, uint8_t shared, uint8_t executable, uint8_t global)
 {
 	ulong_t flags = 0x0;
@@ -329,6 +422,47 @@ void mmuAttachL2pgt(pgt_t pgt, pgt2_t l2pgt, uint32_t v_addr){
     *((ulong_t *)pgt) = pte;
 }
 
+/*
+ * Access permissions of a user address in the L1 entries bits, no access if it isn't mapped
+ */
+static ulong_t MemoryUserAccess(pgt_t pgt, vaddr_t v_addr)
+{
+	ulong_t vaddr = (ulong_t)v_addr;
+
+	// Process page tables only cover the user half of the address space
+	if((vaddr >> SECTION_SHIFT) >= L1PGT_USR_ENTRIES)
+	{
+		return accessCfgs[APOLICY_NANA];
+	}
+
+	ulong_t entry = ((ulong_t*)pgt)[vaddr >> SECTION_SHIFT];
+	ulong_t ap;
+
+	if(entry & 0x2)
+	{
+		// Sections and super sections
+		ap = (entry & (MMU_AP0 | MMU_AP1 | MMU_AP2));
+	}
+	else if(entry & 0x1)
+	{
+		entry = *((ulong_t*)PageTableVirtualAddress((pgt_t)((entry & 0xfffffc00) | ((vaddr & 0xFF000) >> 10))));
+
+		if(!(entry & 0x3))
+		{
+			return accessCfgs[APOLICY_NANA];
+		}
+
+		// Small and large pages keep AP and APX in the same bits, move them to the L1 ones
+		ap = (((entry & 0x30) << 6) | ((entry & 0x200) << 6));
+	}
+	else
+	{
+		return accessCfgs[APOLICY_NANA];
+	}
+
+	return ap;
+}
+
 
 /* Private functions -------------------------------------- */
 
@@ -340,6 +474,14 @@ int32_t mmuInitialization()
 	// The MMU was already initialized in the boot process
 	// No need to initialize page table allocators since we use the
 	// Memory Manager directly
+	kernelL1 = ((uint32_t)MemoryKernelPageTableGet() & ~(L1PGT_ALIGN - 1));
+
+	l2Allocator.top = NULL;
+	KlockInit(&l2Allocator.lock);
+	KlockName(&l2Allocator.lock, "l2Allocator");
+
+	AsidInit();
+
 	return E_OK;
 }
 
@@ -398,11 +540,11 @@ void MemorySynchronize()
 /**
  * MemoryVmaSynchronize Implementation (See header file for description)
 */
-void MemoryVmaSynchronize(vaddr_t v_addr, uint32_t size, uint32_t pid)
+void MemoryVmaSynchronize(vaddr_t v_addr, uint32_t size, uint32_t pid, uint32_t flags)
 {
 	// NOTE: If ASID is zero we are synchronizing kernel memory so do not use the ASID
-	//		 only the virtual address and flush the data cache since for kernel we are not
-	//		 looking at the cache for TLB entries
+	//		 only the virtual address and clean the changed page table entries since for
+	//		 kernel we are not looking at the cache for TLB entries
 
 	// This operation must be atomic
 	uint32_t state = 0;
@@ -410,7 +552,7 @@ void MemoryVmaSynchronize(vaddr_t v_addr, uint32_t size, uint32_t pid)
 
 	// Get Page align addresses
 	uint32_t start = ((uint32_t)v_addr & ~(PAGE_SIZE - 1));
-	uint32_t end = start + (size& ~(PAGE_SIZE - 1));
+	uint32_t end = ALIGN_UP((uint32_t)v_addr + size, PAGE_SIZE);
 
 	// If not specified get current ASID
 	if(pid == -1)
@@ -421,19 +563,30 @@ void MemoryVmaSynchronize(vaddr_t v_addr, uint32_t size, uint32_t pid)
 	// Kernel memory
 	if(pid == 0)
 	{
-		dsb();
-		FlushDcache();
+		KernelPageTableClean(start, end);
 	}
 
-	// Create initial MVA
-	start |= pid;
-
 	// Make all data access visible
 	dsb();
 
-	if(pid != 0)
+	if(((end - start) >> PAGE_SHIFT) > TLB_RANGE_MAX_PAGES)
 	{
-		for(; start < end; start += PAGE_SIZE)
+		// Cheaper to drop the whole address space than to walk the range
+		if(pid != 0)
+		{
+			// Invalidate Unified TLB entry by ASID match Inner Shareable
+			asm volatile("mcr p15, 0, %[asid], c8, c3, 2" : : [asid] "r" (pid));
+		}
+		else
+		{
+			// Invalidate entire unified TLB Inner Shareable
+			asm volatile("mcr p15, 0, %[zero], c8, c3, 0" : : [zero] "r" (0));
+		}
+	}
+	else if(pid != 0)
+	{
+		// Create initial MVA
+		for(start |= pid; start < end; start += PAGE_SIZE)
 		{
 			asm volatile("mcr p15, 0, %[mva], c8, c3, 1" : : [mva] "r" (start));
 		}
@@ -446,8 +599,11 @@ void MemoryVmaSynchronize(vaddr_t v_addr, uint32_t size, uint32_t pid)
 		}
 	}
 
-	// Invalidate Instruction cache since it is virtual indexed
-	InvalidateIcache();
+	// Instruction cache is virtual indexed, only needed when code can be fetched from the range
+	if(flags & MEMORY_SYNC_ICACHE)
+	{
+		InvalidateIcache();
+	}
 
 	dsb();
 	isb();
@@ -462,11 +618,18 @@ pgt_t PageTableAlloc()
 {
 	// To ensure the 16k alignment we first allocate a full page table
 	pgt_t pgt = (pgt_t)MemoryGetAligned(L1PGT_SIZE, L1PGT_ALIGN, ZONE_DIRECT);
-	// Now we return to the Memory Manager the remaining 8k and
-	// keep the lower 8k that have the 16k alignment
-	MemoryFree((ptr_t)((uint32_t)pgt + L1PGT_USR_SIZE), L1PGT_USR_SIZE);
+
+	if(pgt == NULL)
+	{
+		return NULL;
+	}
+
+	// Keep the lower 8k that have the 16k alignment and the following page for
+	// the L2 page tables tracking map, the rest goes back to the Memory Manager
+	MemoryFree((ptr_t)((uint32_t)pgt + L1PGT_USR_SIZE + L2MAP_SIZE), (L1PGT_SIZE - L1PGT_USR_SIZE - L2MAP_SIZE));
 
 	memset(pgt, 0x0, L1PGT_USR_SIZE);
+	memset(L2MAP_GET(pgt), 0x0, sizeof(l2map_t));
 
 	return pgt;
 }
@@ -474,18 +637,24 @@ pgt_t PageTableAlloc()
 /**
  * L1PageTableDealloc Implementation (See header file for description)
 */
-void PageTableDealloc(pid_t pid, pgt_t pgt)
+void PageTableDealloc(uint32_t asid, pgt_t pgt)
 {
+	// A single invalidation by ASID match Inner Shareable drops all the address
+	// space entries, it has to complete before the page tables memory is reused.
+	// An ASID from an older generation is flushed by every cpu on its rollover
+	if(asid != 0)
+	{
+		asm volatile (
+				"dsb									\n\t"
+				"mcr    p15, 0, %[_asid], c8, c3, 2		\n\t"
+				"dsb									\n\t"
+				"isb									\n\t"
+				: : [_asid] "r" (asid)
+		);
+	}
+
 	MemoryMapClean(pgt);
-	MemoryFree((ptr_t)(pgt), L1PGT_USR_SIZE);
-
-	// Invalidate Unified TLB entry by ASID (pid) match Inner Shareable
-	asm volatile (
-			"dsb									\n\t"
-			"mcr    p15, 0, %[_pid], c8, c3, 2		\n\t"
-			"isb									\n\t"
-			: : [_pid] "r" (pid)
-	);
+	MemoryFree((ptr_t)(pgt), L1PGT_USR_SIZE + L2MAP_SIZE);
 }
 
 /**
@@ -493,23 +662,28 @@ void PageTableDealloc(pid_t pid, pgt_t pgt)
 */
 void MemoryMapClean(pgt_t pgt)
 {
-	/*
-	 * This for a big page table is very inefficient!!!
-	 * Is better to have a list of l2 page tables and deallocate them
-	 * through that list. It may also be possible to have a better track
-	 * of the usage of the page table!
-	 */
+	// Only the L1 entries tracked in the map point to L2 page tables, the
+	// remaining entries are faults or sections that don't need any work
 	uint32_t *_pgt = (uint32_t*)pgt;
-    /* Check if is necessary to deallocate L2 page tables */
-	uint32_t i;
-	for(i=0; i < (L1PGT_USR_SIZE >> 2); i++)
+	l2map_t *l2map = L2MAP_GET(pgt);
+	uint32_t word;
+
+	for(word = 0; (word < (L1PGT_USR_ENTRIES >> 5)) && (l2map->count > 0); word++)
 	{
-		if(_pgt[i] & 0x1)
+		uint32_t bits = l2map->bitmap[word];
+
+		while(bits)
 		{
-			uint32_t *l2_pt = PageTableVirtualAddress((pgt_t)(_pgt[i] & 0xfffffc00));
+			uint32_t entry = (word << 5) + (31 - __builtin_clz(bits & -bits));
+			bits &= (bits - 1);
+
+			uint32_t *l2_pt = PageTableVirtualAddress((pgt_t)(_pgt[entry] & 0xfffffc00));
 			L2PageTableDealloc((pgt2_t)l2_pt);
+			_pgt[entry] = 0x0;
+			l2map->count--;
 		}
-		_pgt[i] = 0x0;
+
+		l2map->bitmap[word] = 0x0;
 	}
 }
 
@@ -575,6 +749,7 @@ void MemoryMap(pgt_t pgt, paddr_t p_addr, vaddr_t v_addr, uint32_t size, memCfg_
 				l2pgt = L2PageTableAlloc();
 				// Add entry to the L1 page table
 				mmuAttachL2pgt(pgt, l2pgt, addr);
+				L2MapSet(pgt, pte);
 			}
 			else{
 				// Get the existing L2 page table
@@ -628,63 +803,53 @@ void MemoryUnmap(pgt_t pgt, vaddr_t v_addr, uint32_t size)
 	ulong_t vaddr = (ulong_t)v_addr;
 	// Adjust virtual address to the minimum page size
 	vaddr &= ~(PAGE_SIZE - 1);
-	// Get offset from the beginning of the page table
-	uint32_t offset = (vaddr >> 20);
-	// L1 entries unmap or L2 entries unmap
-	if((size >> 20) && !(vaddr << 12))
+
+	while(size)
 	{
-		uint32_t i;
-		for(i=offset;i<((size >> 20) + offset);i++)
+		// Get offset from the beginning of the page table
+		uint32_t offset = (vaddr >> 20);
+		// L1 entries unmap or L2 entries unmap
+		if((size >> 20) && !(vaddr << 12))
 		{
-			// Check if is necessary to deallocate a L2 page tables
-			if(((ulong_t*)pgt)[i] & 0x1)
+			uint32_t sections = (size >> 20);
+			uint32_t i;
+			for(i = offset; i < (sections + offset); i++)
 			{
-				vaddr_t l2_pt = PageTableVirtualAddress((ptr_t)(((ulong_t*)pgt)[i] & 0xfffffc00));
-				L2PageTableDealloc((pgt2_t)l2_pt);
+				// Check if is necessary to deallocate a L2 page tables
+				if(((ulong_t*)pgt)[i] & 0x1)
+				{
+					vaddr_t l2_pt = PageTableVirtualAddress((ptr_t)(((ulong_t*)pgt)[i] & 0xfffffc00));
+					L2PageTableDealloc((pgt2_t)l2_pt);
+					L2MapClear(pgt, i);
+				}
+				// Clean entry
+				((ulong_t*)pgt)[i] = 0x0;
 			}
-			// Clean entry
-			((ulong_t*)pgt)[i] = 0x0;
-		}
-		if(size & (SECTION_SIZE - 1))
-		{
-			// Resolve pending memory sections in a recursive way
-			MemoryUnmap(pgt, (vaddr_t)(vaddr + (size & ~(SECTION_SIZE - 1))), (size & (SECTION_SIZE - 1)));
+			vaddr += (sections << 20);
+			size &= (SECTION_SIZE - 1);
 		}
-	}
-	else{
-		// Get L2 Page Table
-		ulong_t* l2pgt = PageTableVirtualAddress((ptr_t)(((ulong_t*)pgt)[offset] & 0xfffffc00));
-
-		// Get base entry for the virtual address
-		l2pgt += ((vaddr & 0xFF000) >> 12);
-		// Check if the memory section pass the 1MB boundary
-		uint32_t overflow = ((vaddr & (SECTION_SIZE-1)) + size);
-		// If the memory section overflows to the next 1MB section
-		if(overflow > SECTION_SIZE)
+		else
 		{
-			// Compute memory section size being unmap in the first section
+			// Compute memory section size being unmap in this section
 			uint32_t unmap_size = SECTION_SIZE - (vaddr & (SECTION_SIZE-1));
-			uint32_t i;
-			// Clear entries
-			for(i=0; i<unmap_size; i+=PAGE_SIZE)
+			unmap_size = ((size < unmap_size) ? (size) : (unmap_size));
+
+			if(((ulong_t*)pgt)[offset] & 0x1)
 			{
-				*l2pgt++ = 0x0;
+				// Get L2 Page Table
+				ulong_t* l2pgt = PageTableVirtualAddress((ptr_t)(((ulong_t*)pgt)[offset] & 0xfffffc00));
+				// Get base entry for the virtual address
+				l2pgt += ((vaddr & 0xFF000) >> 12);
+				// Clear entries
+				uint32_t i;
+				for(i = 0; i < unmap_size; i += PAGE_SIZE)
+				{
+					*l2pgt++ = 0x0;
+				}
 			}
-			// Compute the memory size to be unmapped in the next iteration
+
+			vaddr += unmap_size;
 			size -= unmap_size;
-			if(size)
-			{
-				// Resolve pending memory sections in a recursive way
-				MemoryUnmap(pgt, (vaddr_t)(vaddr + unmap_size), size);
-			}
-		}
-		else{
-			// Clear entries
-			uint32_t i;
-			for(i=0; i<size; i+=PAGE_SIZE)
-			{
-				*l2pgt++ = 0x0;
-			}
 		}
 	}
 }
@@ -730,3 +895,21 @@ paddr_t MemoryVirtual2physical(pgt_t pgt, vaddr_t v_addr)
     }
     return (paddr_t)p_addr;
 }
+
+/**
+ * MemoryUserWritable Implementation (See header file for description)
+*/
+bool_t MemoryUserWritable(pgt_t pgt, vaddr_t v_addr)
+{
+	return (MemoryUserAccess(pgt, v_addr) == accessCfgs[APOLICY_RWRW]);
+}
+
+/**
+ * MemoryUserReadable Implementation (See header file for description)
+*/
+bool_t MemoryUserReadable(pgt_t pgt, vaddr_t v_addr)
+{
+	ulong_t ap = MemoryUserAccess(pgt, v_addr);
+
+	return ((ap == accessCfgs[APOLICY_RWRW]) || (ap == accessCfgs[APOLICY_RWRO]) || (ap == accessCfgs[APOLICY_RORO]));
+}
@@ -0,0 +1,101 @@
+/**
+ * @file        pmu.c
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        18 October, 2026
+ * @brief       Performance Monitor Unit implementation
+*/
+
+
+/* Includes ----------------------------------------------- */
+#include <pmu.h>
+#include <asm.h>
+
+
+/* Private types ------------------------------------------ */
+
+
+
+/* Private constants -------------------------------------- */
+
+// PMCR
+#define PMCR_ENABLE					(1 << 0)
+#define PMCR_EVENT_RESET			(1 << 1)
+#define PMCR_CYCLE_RESET			(1 << 2)
+
+// PMCNTENSET
+#define PMCNTEN_CYCLES				(1 << 31)
+
+
+/* Private macros ----------------------------------------- */
+
+
+
+/* Private variables -------------------------------------- */
+
+
+
+/* Private function prototypes ---------------------------- */
+
+static void PmuSelect(uint32_t counter)
+{
+	// PMSELR - Event Counter Selection Register
+	asm volatile ("mcr p15, 0, %0, c9, c12, 5" : : "r" (counter));
+	isb();
+}
+
+
+/* Private functions -------------------------------------- */
+
+/**
+ * PmuInit Implementation (See header file for description)
+*/
+void PmuInit(void)
+{
+	uint32_t pmcr;
+
+	asm volatile ("mrc p15, 0, %0, c9, c12, 0" : "=r" (pmcr));
+	pmcr |= (PMCR_ENABLE | PMCR_EVENT_RESET | PMCR_CYCLE_RESET);
+	asm volatile ("mcr p15, 0, %0, c9, c12, 0" : : "r" (pmcr));
+
+	PmuEventSet(PMU_COUNTER_DTLB, PMU_EVENT_DTLB_REFILL);
+	PmuEventSet(PMU_COUNTER_ITLB, PMU_EVENT_ITLB_REFILL);
+
+	// PMCNTENSET - Count Enable Set Register
+	uint32_t enable = (PMCNTEN_CYCLES | (1 << PMU_COUNTER_DTLB) | (1 << PMU_COUNTER_ITLB));
+	asm volatile ("mcr p15, 0, %0, c9, c12, 1" : : "r" (enable));
+	isb();
+}
+
+/**
+ * PmuEventSet Implementation (See header file for description)
+*/
+void PmuEventSet(uint32_t counter, uint32_t event)
+{
+	PmuSelect(counter);
+	// PMXEVTYPER - Event Type Select Register
+	asm volatile ("mcr p15, 0, %0, c9, c13, 1" : : "r" (event));
+}
+
+/**
+ * PmuCounterRead Implementation (See header file for description)
+*/
+uint32_t PmuCounterRead(uint32_t counter)
+{
+	uint32_t value;
+	PmuSelect(counter);
+	// PMXEVCNTR - Event Count Register
+	asm volatile ("mrc p15, 0, %0, c9, c13, 2" : "=r" (value));
+	return value;
+}
+
+/**
+ * PmuCyclesRead Implementation (See header file for description)
+*/
+uint32_t PmuCyclesRead(void)
+{
+	uint32_t value;
+	// PMCCNTR - Cycle Count Register
+	asm volatile ("mrc p15, 0, %0, c9, c13, 0" : "=r" (value));
+	return value;
+}
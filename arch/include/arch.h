@@ -23,6 +23,9 @@
 
 /* Exported constants ------------------------------------- */
 
+// Maximum number of cpus in the cluster (Cortex-A7/A9 MPCore)
+#define MAX_CPUS				4
+
 
 /* Exported macros ---------------------------------------- */
 #define RUNNING_CPU				_cpuId()
@@ -141,7 +144,7 @@ void _TaskSave(void* tcb);
  *
  * @retval	No return
  */
-void _VirtualSpaceSet(void* tcb, pgt_t pgt, pid_t pid);
+void _VirtualSpaceSet(void* tcb, pgt_t pgt, uint32_t asid);
 
 
 void _TerminateRunningTask();
@@ -162,7 +165,7 @@ void cpus_set_stacks(void* stacks);
 
 void _SchedulerStart(void* tcb, void* restore_ksp);
 
-void _SchedResumeTask(void* tcb, pgt_t pgt, pid_t pid);
+void _SchedResumeTask(void* tcb, pgt_t pgt, uint32_t asid);
 
 void *_IdleTask(void *arg);
 
@@ -0,0 +1,68 @@
+/**
+ * @file        asid.h
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        18 October, 2026
+ * @brief       Address Space Identifiers Allocator Header File
+*/
+
+#ifndef _ASID_H
+#define _ASID_H
+
+
+/* Includes ----------------------------------------------- */
+#include <types.h>
+
+
+/* Exported constants ------------------------------------- */
+
+#define ASID_BITS				(8)
+#define ASID_MASK				((1UL << ASID_BITS) - 1)
+
+
+/* Exported types ----------------------------------------- */
+
+// Generation in the upper bits and the hardware ASID in the lower bits, zero if never assigned
+typedef uint32_t asid_t;
+
+
+/* Exported macros ---------------------------------------- */
+
+
+
+/* Exported functions ------------------------------------- */
+
+/*
+ * @brief   Initialize the ASID allocator. ASID 0 is kept for the kernel
+ * @param   None
+ * @retval  No Return
+ */
+void AsidInit(void);
+
+/*
+ * @brief   Get the hardware ASID to switch the running cpu to an address space.
+ *          A new ASID is assigned when the address space ASID is from an older
+ *          generation, when they run out a new generation starts and every cpu
+ *          invalidates its TLB before it uses an ASID of the new generation.
+ *          Must be called with interrupts disabled
+ * @param   asid - address space ASID
+ * @retval  Hardware ASID
+ */
+uint32_t AsidGet(asid_t *asid);
+
+/*
+ * @brief   Get the hardware ASID of an address space if it can still have TLB entries
+ * @param   asid - address space ASID
+ * @retval  Hardware ASID or 0 if the ASID is from an older generation and no cpu
+ *          kept it reserved
+ */
+uint32_t AsidHardware(asid_t *asid);
+
+/*
+ * @brief   Release the address space ASID. The TLB entries have to be invalidated before
+ * @param   asid - address space ASID
+ * @retval  No Return
+ */
+void AsidRelease(asid_t *asid);
+
+#endif /* _ASID_H */
@@ -42,6 +42,14 @@ int32_t atomic_inc(int32_t* data);
  */
 int32_t atomic_dec(int32_t* data);
 
+/*
+ * @brief   Adds in an atomic way a value to the specified variable
+ * @param   data - pointer to the variable being added to
+ * 			value - value to add
+ * @retval  Result
+ */
+int32_t atomic_add(int32_t* data, int32_t value);
+
 /*
  * @brief   If cmp is equal to *dst set the *dst with the specified value
  * @param   dst 	- pointer to the variable
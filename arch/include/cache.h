@@ -51,6 +51,14 @@ void FlushDcache(void);
 
 void FlushDcacheRange(ptr_t addr, size_t size);
 
+/*
+ * @brief   Cleans a Data Cache range to the point of coherency
+ * @param   addr - base virtual address
+ *          size - size of the range
+ * @retval  No Return
+ */
+void CleanDcacheRange(ptr_t addr, size_t size);
+
 /*
  * @brief   Invalidate Data and Instruction Caches
  * @param   None
@@ -36,6 +36,21 @@ void InterruptDisable(uint32_t irq);
 
 void InterruptSetTarget(uint32_t irq, uint32_t target, uint32_t set);
 
+/*
+ * @brief   Set the cpus an interrupt is forwarded to
+ * @param   irq - interrupt number
+ *          mask - cpu mask, bit n for cpu n
+ * @retval  No Return
+ */
+void InterruptSetTargets(uint32_t irq, uint32_t mask);
+
+/*
+ * @brief   Get the cpus an interrupt is forwarded to
+ * @param   irq - interrupt number
+ * @retval  Cpu mask
+ */
+uint32_t InterruptGetTargets(uint32_t irq);
+
 int32_t InterruptSetPriority(uint32_t irq, uint32_t priority);
 
 void InterruptGenerate(uint32_t irq, uint32_t cpu);
@@ -18,6 +18,9 @@
 /* Exported constants ------------------------------------- */
 
 #define PAGE_SIZE				4096
+#define LARGE_PAGE_SIZE			0x10000
+#define SECTION_SIZE			0x100000
+#define LARGE_SECTION_SIZE		0x1000000
 
 #define CPOLICY_STRONGLY_ORDERED	0
 #define CPOLICY_UNCACHED			1
@@ -34,6 +37,9 @@
 #define APOLICY_RONA			4	// Kernel read only, User no access
 #define APOLICY_RORO			5	// Kernel read only, User read only
 
+#define MEMORY_SYNC_TLB			0			// Only the TLB entries of the range
+#define MEMORY_SYNC_ICACHE		(1 << 0)	// The range is or was executable
+
 
 /* Exported macros ---------------------------------------- */
 
@@ -82,12 +88,16 @@ void MemorySynchronize(void);
 pgt_t MemoryKernelPageTableGet(void);
 
 /*
- * @brief   Synchronize the specified virtual address space
+ * @brief   Synchronize the specified virtual address space. The TLB entries are
+ * 			invalidated by MVA or, for big ranges, by ASID. For kernel memory the
+ * 			changed page table entries are cleaned from the data cache
  * @param   v_addr - base virtual address
  * 			size - size of the address space
+ * 			pid - address space ASID, 0 for kernel or -1 for the running one
+ * 			flags - MEMORY_SYNC_ICACHE to also invalidate the instruction cache
  * @retval  No Return
  */
-void MemoryVmaSynchronize(vaddr_t v_addr, uint32_t size, uint32_t pid);
+void MemoryVmaSynchronize(vaddr_t v_addr, uint32_t size, uint32_t pid, uint32_t flags);
 
 /*
  * @brief   Maps the specified virtual address space with the specified memory configuration
@@ -109,7 +119,9 @@ void MemoryMap(pgt_t pgt, paddr_t p_addr, vaddr_t v_addr, uint32_t size, memCfg_
 void MemoryUnmap(pgt_t pgt, vaddr_t v_addr, uint32_t size);
 
 /*
- * @brief   Flushes the page table. All lower level page tables will be deallocated.
+ * @brief   Flushes a user page table. All lower level page tables will be deallocated.
+ * 			Only the L2 page tables tracked for the address space are visited, the TLB
+ * 			is not maintained here
  * @param   pgt - page table
  * @retval  No return
  */
@@ -123,6 +135,22 @@ void MemoryMapClean(pgt_t pgt);
  */
 paddr_t MemoryVirtual2physical(pgt_t pgt, vaddr_t v_addr);
 
+/*
+ * @brief   Check if user space can write to a virtual address
+ * @param   pgt - process page table
+ *          v_addr - virtual address
+ * @retval  TRUE if it is mapped user read and write
+ */
+bool_t MemoryUserWritable(pgt_t pgt, vaddr_t v_addr);
+
+/*
+ * @brief   Check if user space can read a virtual address
+ * @param   pgt - process page table
+ *          v_addr - virtual address
+ * @retval  TRUE if it is mapped user read only or read and write
+ */
+bool_t MemoryUserReadable(pgt_t pgt, vaddr_t v_addr);
+
 /*
  * @brief   Allocates a new level 1 page table.
  * 			Note that if there is different sizes of level 1 page tables only the page
@@ -134,11 +162,13 @@ pgt_t PageTableAlloc(void);
 
 /*
  * @brief   Deallocates the specified page table.
- * 			Note that before the deallocation the function MemoryMapClean will be called
- * 			for the specified page table
- * @param   pgt - page table
+ * 			Note that before the deallocation the TLB entries of the address space are
+ * 			invalidated by ASID and the function MemoryMapClean will be called for the
+ * 			specified page table
+ * @param   asid - hardware ASID of the address space, 0 if it has no TLB entries
+ * 			pgt - page table
  * @retval  No return
  */
-void PageTableDealloc(pid_t pid, pgt_t pgt);
+void PageTableDealloc(uint32_t asid, pgt_t pgt);
 
 #endif // MMU_H
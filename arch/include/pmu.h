@@ -0,0 +1,68 @@
+/**
+ * @file        pmu.h
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        18 October, 2026
+ * @brief       Performance Monitor Unit Definition Header File
+*/
+
+#ifndef _PMU_H
+#define _PMU_H
+
+
+/* Includes ----------------------------------------------- */
+#include <types.h>
+
+
+/* Exported constants ------------------------------------- */
+
+// ARMv7 common events
+#define PMU_EVENT_ITLB_REFILL		(0x02)
+#define PMU_EVENT_DTLB_REFILL		(0x05)
+
+// Counters set by PmuInit
+#define PMU_COUNTER_DTLB			(0)
+#define PMU_COUNTER_ITLB			(1)
+
+
+/* Exported types ----------------------------------------- */
+
+
+
+/* Exported macros ---------------------------------------- */
+
+
+
+/* Exported functions ------------------------------------- */
+
+/*
+ * @brief   Enable the running cpu PMU. The cycle counter is started and the
+ *          first two event counters count data and instruction TLB refills
+ * @param   None
+ * @retval  No Return
+ */
+void PmuInit(void);
+
+/*
+ * @brief   Set the event counted by an event counter
+ * @param   counter - event counter
+ *          event - event number
+ * @retval  No Return
+ */
+void PmuEventSet(uint32_t counter, uint32_t event);
+
+/*
+ * @brief   Read an event counter of the running cpu
+ * @param   counter - event counter
+ * @retval  Counter value
+ */
+uint32_t PmuCounterRead(uint32_t counter);
+
+/*
+ * @brief   Read the cycle counter of the running cpu
+ * @param   None
+ * @retval  Cycle counter value
+ */
+uint32_t PmuCyclesRead(void);
+
+#endif /* _PMU_H */
@@ -42,6 +42,18 @@ void critical_lock(uint32_t* state);
  */
 void critical_unlock(uint32_t* state);
 
+#ifdef KLOCK_STATS
+/*
+ * @brief   Spin lock functions without the contention profiling, spinlock and
+ *          spinunlock wrap them in kernels built with KLOCK_STATS
+ * @param   lock - the spin lock
+ * @retval  No value returned
+ */
+void spinlock_raw(spinlock_t* lock);
+
+void spinunlock_raw(spinlock_t* lock);
+#endif
+
 /*
  * @brief   Initializes the spin lock
  * @param   lock - the spin lock
@@ -58,6 +58,43 @@ void SystemTimerHandler();
 
 int32_t SystemTimerIrq();
 
+/*
+ * @brief   Read the free running counter shared by all cpus, values read on
+ *          different cpus can be compared
+ * @param   None
+ * @retval  Counter value
+ */
+uint64_t SystemCounterRead();
+
+/*
+ * @brief   Get the frequency of the free running counter
+ * @param   None
+ * @retval  Counter frequency in Hz
+ */
+uint32_t SystemCounterFreq();
+
+/*
+ * @brief   Attach the running cpu deadline timer interrupt, each cpu has its own
+ * @param   handler - interrupt handler
+ * @retval  No return
+ */
+void SystemDeadlineStart(void* (*handler)(void*, uint32_t));
+
+/*
+ * @brief   Interrupt the running cpu once the free running counter reaches the
+ *          deadline, right away if it is already past
+ * @param   deadline - counter value
+ * @retval  No return
+ */
+void SystemDeadlineSet(uint64_t deadline);
+
+/*
+ * @brief   Disable and acknowledge the running cpu deadline timer
+ * @param   None
+ * @retval  No return
+ */
+void SystemDeadlineClear();
+
 #ifdef __cplusplus
     }
 #endif
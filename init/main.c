@@ -8,6 +8,12 @@
 #include <rfs.h>
 #include <isr.h>
 #include <sleep.h>
+#include <process.h>
+#include <mutex.h>
+#include <semaphore.h>
+#include <klock.h>
+#include <rcu.h>
+#include <hrtimer.h>
 
 #include <board.h>
 #include <arch.h>
@@ -120,6 +126,41 @@ void *RunningTaskTcb()
 	return SchedGetRunningTask()->memory.registers;
 }
 
+// Data Fault Status Register fields (short descriptor format)
+#define DFSR_STATUS(dfsr)			(((dfsr) & 0xF) | (((dfsr) >> 6) & 0x10))
+#define DFSR_TRANSLATION_SECTION	(0x05)
+#define DFSR_TRANSLATION_PAGE		(0x07)
+#define DFSR_PERMISSION_SECTION		(0x0D)
+#define DFSR_PERMISSION_PAGE		(0x0F)
+#define DFSR_WNR					(0x1 << 11)
+
+/*
+ * Called by the abort entry before giving up on a data abort. Translation
+ * faults inside on demand objects and writes to shared .data pages are
+ * solved by mapping a page, in that case the aborted instruction is restarted
+ */
+int32_t AbortDataFault(uint32_t cause, vaddr_t faddr)
+{
+	process_t* process = SchedGetRunningProcess();
+
+	if(process == NULL)
+	{
+		return E_FAULT;
+	}
+
+	switch(DFSR_STATUS(cause))
+	{
+	case DFSR_TRANSLATION_SECTION:
+	case DFSR_TRANSLATION_PAGE:
+		return ProcessPageFault(process, faddr, FALSE);
+	case DFSR_PERMISSION_SECTION:
+	case DFSR_PERMISSION_PAGE:
+		return ((cause & DFSR_WNR) ? ProcessPageFault(process, faddr, TRUE) : E_FAULT);
+	default:
+		return E_FAULT;
+	}
+}
+
 #ifdef USE_ABORT_HANDLER
 
 void *AbortDataHandler(uint32_t cause, vaddr_t faddr)
@@ -271,6 +312,51 @@ void* FaultDumper(uint32_t fault, vaddr_t addr, vaddr_t user_sp, vaddr_t user_lr
 	return NULL;
 }
 
+/*
+ * Demand faults and large mmaps take size aligned 64KB blocks the way the
+ * process pages are taken, warn when the memory manager can't hand them out
+ */
+static void LargePageCheck()
+{
+	paddr_t paddr = MemoryGetAligned(LARGE_PAGE_SIZE, LARGE_PAGE_SIZE, ZONE_INDIRECT);
+
+	if((paddr == NULL) || ((uint32_t)paddr & (LARGE_PAGE_SIZE - 1)))
+	{
+		DebugOut("\nLarge pages: not available");
+	}
+
+	if(paddr != NULL)
+	{
+		MemoryFree(paddr, LARGE_PAGE_SIZE);
+	}
+}
+
+#ifdef KLOCK_TORTURE
+static void KlockTortureReport()
+{
+	klock_torture_t result;
+	char string[11];
+	uint32_t cpu;
+
+	KlockTorture(&result);
+
+	DebugOut("\nKlock torture: ");
+	DebugOut(itoa(result.total, string, 10));
+	DebugOut(" locks in ");
+	DebugOut(itoa(result.cycles, string, 10));
+	DebugOut(" cycles");
+
+	// A fair lock gives each cpu about the same share
+	for(cpu = 0; cpu < result.cpus; cpu++)
+	{
+		DebugOut("\n  CPU ");
+		DebugOut(itoa(cpu, string, 10));
+		DebugOut(": ");
+		DebugOut(itoa(result.acquired[cpu], string, 10));
+	}
+}
+#endif
+
 void kernelMain(bootLayout_t *bootLayout)
 {
 	// Initialize the Raw File System
@@ -295,6 +381,8 @@ void kernelMain(bootLayout_t *bootLayout)
 	DebugOut("\nBoard: ");
 	DebugOut(RfsGetMach());
 
+	LargePageCheck();
+
 	DebugOut("\n\nInitialize loader");
 
 	BoardEarlyInit();
@@ -306,9 +394,23 @@ void kernelMain(bootLayout_t *bootLayout)
 	// Initialize Scheduler  NOTE: Will unlock secondary cpus
 	SchedulerInit(1000);
 
+#ifdef KLOCK_TORTURE
+	KlockTortureReport();
+#endif
+
 	// Initialize sleep handler
 	SleepInit();
 
+	// Initialize the per cpu deadline timers queues
+	HrtimerInit();
+
+	// Initialize deferred release of lock-free looked up objects
+	RcuInit(BoardGetCpus());
+
+	// Initialize user lock words wait queues
+	MutexWordInit();
+	SemWordInit();
+
 	DebugOut("\nInitialize Process Manager");
 	// Initialize Process Manager
 	ProcManagerInit();
@@ -339,6 +441,10 @@ void kernelMainSec()
 
 	BoardSecCpuInit();
 
+#ifdef KLOCK_TORTURE
+	KlockTorture(NULL);
+#endif
+
 	SchedulerStart();
 }
 
@@ -79,16 +79,29 @@ cond_t* GetCondPtr(cond_t* cond)
 
 void CondResumeTimeout(void* cond, task_t* task)
 {
-	(void)cond;
+	cond_t* cv = (cond_t*)cond;
+	mutex_t* mutex = cv->mutex;
 
-	if(GlistRemoveSpecific(&task->node) != E_OK)
+	if(mutex == NULL)
+	{
+		return;
+	}
+
+	uint32_t state = 0;
+	spinlock_irq(&mutex->spinLock, &state);
+
+	// Signalled tasks are moved to the mutex queue, the timeout no longer applies to them
+	if((task->node.owner != (void*)&cv->queue) || (GlistRemoveSpecific(&task->node) != E_OK))
 	{
 		// We were no longer in the queue so this timeout has no effect
+		spinunlock_irq(&mutex->spinLock, &state);
 		return;
 	}
 
 	task->ret = E_TIMED_OUT;
 
+	spinunlock_irq(&mutex->spinLock, &state);
+
 	SchedAddTask(task);
 }
 
@@ -147,21 +160,7 @@ int32_t CondWait(cond_t* cond, mutex_t** mutex)
 		return E_ERROR;
 	}
 
-	GlistInsertObject(&cond->queue, &task->node);
-
-	if(task->timeout.set == TRUE)
-	{
-		TimerSet(task, CondResumeTimeout, cond);
-	}
-
-	uint32_t status;
-	SchedLock(&status);
-
-	MutexUnlock((*mutex));
-
-	int32_t ret = SchedStopRunningTask(BLOCKED, COND);
-
-	critical_unlock(&status);
+	int32_t ret = MutexCondWait((*mutex), &cond->queue, CondResumeTimeout, cond);
 
 	if(task->timeout.set == TRUE)
 	{
@@ -173,7 +172,11 @@ int32_t CondWait(cond_t* cond, mutex_t** mutex)
 		return ret;
 	}
 
-	ret = MutexLock((*mutex));
+	// Signalled tasks are handed the mutex, only if woken up otherwise we have to lock it
+	if((*mutex)->owner != task)
+	{
+		ret = MutexLock((*mutex));
+	}
 
 	if(GLIST_EMPTY(&cond->queue))
 	{
@@ -188,28 +191,26 @@ int32_t CondSignal(cond_t* cond, int32_t count)
 {
 	cond = GetCondPtr(cond);
 
-	if(cond == NULL || count < 0 || MutexLock(cond->mutex) != E_OK)
+	if(cond == NULL || count < 0)
 	{
 		return E_INVAL;
 	}
 
-	if((count == 0) || (count > cond->queue.count))
+	mutex_t* mutex = cond->mutex;
+
+	// No one ever waited or the last waiter left
+	if(mutex == NULL)
 	{
-		count = cond->queue.count;
+		return E_OK;
 	}
 
-	for(; count > 0; --count)
+	// Waiters are moved to the mutex queue, the mutex doesn't have to be taken here
+	if(MutexCondRequeue(mutex, &cond->queue, count) > 0)
 	{
-		task_t* task = GLISTNODE2TYPE(GlistRemoveFirst(&cond->queue), task_t, node);
-		task->ret = E_OK;
-		SchedAddTask(task);
+		// Are we still the highest priority task
+		SchedYield();
 	}
 
-	MutexUnlock(cond->mutex);
-
-	// Are we still the highest priority task
-	SchedYield();
-
 	return E_OK;
 }
 
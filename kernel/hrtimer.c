@@ -0,0 +1,302 @@
+/**
+ * @file        hrtimer.c
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        18 October, 2026
+ * @brief       High Resolution Timers implementation
+*/
+
+/* Includes ----------------------------------------------- */
+#include <hrtimer.h>
+#include <arch.h>
+#include <klock.h>
+#include <spinlock.h>
+#include <systimer.h>
+#include <scheduler.h>
+#include <process.h>
+#include <string.h>
+
+
+/* Private types ------------------------------------------ */
+
+typedef struct
+{
+	klock_t		lock;
+	glist_t		timers;		// Sorted by deadline, the first one is programmed
+#ifdef HRTIMER_JITTER
+	uint32_t	count;
+	uint32_t	max;
+	uint32_t	buckets[HRTIMER_JITTER_BUCKETS];
+#endif
+}hrqueue_t;
+
+
+/* Private constants -------------------------------------- */
+
+
+
+/* Private macros ----------------------------------------- */
+
+
+
+/* Private variables -------------------------------------- */
+
+static struct
+{
+	hrqueue_t	cpu[MAX_CPUS];
+	uint32_t	freq;
+	uint32_t	nsMult;		// Counter ticks per nanosecond, 32 bits fraction rounded up
+	uint32_t	tickNs;		// Nanoseconds per counter tick, 24 bits fraction
+}hrtimers;
+
+
+/* Private function prototypes ---------------------------- */
+
+static inline uint64_t HrtimerTicks(const timespec_t *time)
+{
+	return (((uint64_t)time->sec * hrtimers.freq) + (((uint64_t)time->nsec * hrtimers.nsMult) >> 32));
+}
+
+static int32_t HrtimerSort(glistNode_t *current, glistNode_t *node)
+{
+	hrtimer_t *c = GLISTNODE2TYPE(current, hrtimer_t, node);
+	hrtimer_t *t = GLISTNODE2TYPE(node, hrtimer_t, node);
+
+	// Same deadlines expire in the order they were started
+	return (t->expires >= c->expires);
+}
+
+#ifdef HRTIMER_JITTER
+static void HrtimerLate(hrqueue_t *queue, uint64_t late)
+{
+	uint32_t ticks = ((late >> 32) ? (0xFFFFFFFF) : ((uint32_t)late));
+
+	queue->count++;
+	queue->buckets[(ticks != 0) ? (31 - __builtin_clz(ticks)) : (0)]++;
+
+	if(ticks > queue->max)
+	{
+		queue->max = ticks;
+	}
+}
+#endif
+
+static void *HrtimerInterrupt(void *arg, uint32_t irq)
+{
+	(void)arg; (void)irq;
+
+	hrqueue_t *queue = &hrtimers.cpu[RUNNING_CPU];
+
+	uint32_t status;
+	Klock(&queue->lock, &status);
+
+	SystemDeadlineClear();
+
+	hrtimer_t *timer = GLIST_FIRST(&queue->timers, hrtimer_t, node);
+	uint64_t now = SystemCounterRead();
+
+	while((timer != NULL) && (timer->expires <= now))
+	{
+		GlistRemoveSpecific(&timer->node);
+
+#ifdef HRTIMER_JITTER
+		HrtimerLate(queue, now - timer->expires);
+#endif
+
+		// Handlers wake tasks up, the scheduler lock is taken before ours
+		Kunlock(&queue->lock, NULL);
+		timer->handler(timer);
+		Klock(&queue->lock, NULL);
+
+		timer = GLIST_FIRST(&queue->timers, hrtimer_t, node);
+		now = SystemCounterRead();
+	}
+
+	if(timer != NULL)
+	{
+		SystemDeadlineSet(timer->expires);
+	}
+
+	Kunlock(&queue->lock, &status);
+
+	return NULL;
+}
+
+
+/* Private functions -------------------------------------- */
+
+/**
+ * HrtimerInit Implementation (See header file for description)
+*/
+void HrtimerInit(void)
+{
+	uint32_t cpu;
+
+	memset(&hrtimers, 0x0, sizeof(hrtimers));
+
+	for(cpu = 0; cpu < MAX_CPUS; cpu++)
+	{
+		KlockInit(&hrtimers.cpu[cpu].lock);
+		KlockName(&hrtimers.cpu[cpu].lock, "hrtimer");
+		GlistInitialize(&hrtimers.cpu[cpu].timers, GList);
+		(void)GlistSetSort(&hrtimers.cpu[cpu].timers, HrtimerSort);
+	}
+
+	hrtimers.freq = SystemCounterFreq();
+	// Rounded up so a timer never fires before its deadline
+	hrtimers.nsMult = (uint32_t)((((uint64_t)hrtimers.freq) << 32) / HRTIMER_NSEC_PER_SEC) + 1;
+	hrtimers.tickNs = (uint32_t)((((uint64_t)HRTIMER_NSEC_PER_SEC) << 24) / hrtimers.freq);
+}
+
+/**
+ * HrtimerCpuStart Implementation (See header file for description)
+*/
+void HrtimerCpuStart(void)
+{
+	SystemDeadlineStart(HrtimerInterrupt);
+}
+
+/**
+ * HrtimerStart Implementation (See header file for description)
+*/
+int32_t HrtimerStart(hrtimer_t *timer, const timespec_t *time, uint32_t mode, void (*handler)(hrtimer_t *timer))
+{
+	if((timer == NULL) || (time == NULL) || (handler == NULL) || (time->nsec >= HRTIMER_NSEC_PER_SEC))
+	{
+		return E_INVAL;
+	}
+
+	(void)HrtimerCancel(timer);
+
+	uint32_t status;
+	critical_lock(&status);
+
+	// The deadline timer is private, the timer stays with the cpu that started it
+	hrqueue_t *queue = &hrtimers.cpu[RUNNING_CPU];
+
+	Klock(&queue->lock, NULL);
+
+	timer->handler = handler;
+	timer->cpu = RUNNING_CPU;
+	timer->expires = HrtimerTicks(time);
+
+	if(mode == HRTIMER_REL)
+	{
+		timer->expires += SystemCounterRead();
+	}
+
+	GlistInsertObject(&queue->timers, &timer->node);
+
+	if(GLIST_FIRST(&queue->timers, hrtimer_t, node) == timer)
+	{
+		SystemDeadlineSet(timer->expires);
+	}
+
+	Kunlock(&queue->lock, NULL);
+	critical_unlock(&status);
+
+	return E_OK;
+}
+
+/**
+ * HrtimerCancel Implementation (See header file for description)
+*/
+bool_t HrtimerCancel(hrtimer_t *timer)
+{
+	if(timer == NULL)
+	{
+		return FALSE;
+	}
+
+	hrqueue_t *queue = &hrtimers.cpu[timer->cpu];
+
+	uint32_t status;
+	Klock(&queue->lock, &status);
+
+	// The deadline is left programmed, an early interrupt finds nothing to run
+	bool_t pending = (timer->node.owner == &queue->timers);
+
+	if(pending)
+	{
+		GlistRemoveSpecific(&timer->node);
+	}
+
+	Kunlock(&queue->lock, &status);
+
+	return pending;
+}
+
+/**
+ * ClockGetTime Implementation (See header file for description)
+*/
+int32_t ClockGetTime(timespec_t *time)
+{
+	process_t *process = SchedGetRunningProcess();
+
+	// Both words, the timespec can cross a page boundary
+	if(!ProcessUserWordValid(process, &time->sec) || !ProcessUserWordValid(process, &time->nsec))
+	{
+		return E_INVAL;
+	}
+
+	uint64_t now = SystemCounterRead();
+
+	time->sec = (uint32_t)(now / hrtimers.freq);
+	time->nsec = (uint32_t)(((now % hrtimers.freq) * hrtimers.tickNs) >> 24);
+
+	return E_OK;
+}
+
+/**
+ * HrtimerJitterRead Implementation (See header file for description)
+*/
+int32_t HrtimerJitterRead(char *buffer, size_t size, uint32_t *offset)
+{
+#ifdef HRTIMER_JITTER
+	if((buffer == NULL) || (size < sizeof(hrtimer_jitter_t)))
+	{
+		return E_INVAL;
+	}
+
+	hrtimer_jitter_t *jitter = (hrtimer_jitter_t*)buffer;
+	uint32_t cpu, bucket;
+
+	memset(jitter, 0x0, sizeof(hrtimer_jitter_t));
+	jitter->freq = hrtimers.freq;
+
+	// Read without the queues locks, counts can be off by the timers in flight
+	for(cpu = 0; cpu < MAX_CPUS; cpu++)
+	{
+		hrqueue_t *queue = &hrtimers.cpu[cpu];
+
+		jitter->count += queue->count;
+
+		if(queue->max > jitter->max)
+		{
+			jitter->max = queue->max;
+		}
+
+		for(bucket = 0; bucket < HRTIMER_JITTER_BUCKETS; bucket++)
+		{
+			jitter->buckets[bucket] += queue->buckets[bucket];
+		}
+	}
+
+	if(offset != NULL)
+	{
+		*offset = sizeof(hrtimer_jitter_t);
+	}
+
+	return E_OK;
+#else
+	(void)buffer; (void)size;
+
+	// Kernel built without HRTIMER_JITTER
+	if(offset != NULL)
+	{
+		*offset = 0;
+	}
+
+	return E_INVAL;
+#endif
+}
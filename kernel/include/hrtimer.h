@@ -0,0 +1,111 @@
+/**
+ * @file        hrtimer.h
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        18 October, 2026
+ * @brief       High Resolution Timers Definition Header File
+*/
+
+#ifndef _HRTIMER_H_
+#define _HRTIMER_H_
+
+
+/* Includes ----------------------------------------------- */
+#include <types.h>
+#include <glist.h>
+
+
+/* Exported constants ------------------------------------- */
+
+// Deadline modes
+#define HRTIMER_REL				(0)		// From now
+#define HRTIMER_ABS				(1)		// Time since boot, as read by ClockGetTime
+
+#define HRTIMER_NSEC_PER_SEC	(1000000000UL)
+
+// Bucket n counts lateness in [2^n, 2^(n+1)) counter ticks, bucket 0 also counts zero
+#define HRTIMER_JITTER_BUCKETS	(32)
+
+
+/* Exported types ----------------------------------------- */
+
+typedef struct
+{
+	uint32_t	sec;
+	uint32_t	nsec;
+}timespec_t;
+
+// One-shot timer, runs on the deadline timer of the cpu that started it
+typedef struct hrtimer
+{
+	glistNode_t	node;
+	uint64_t	expires;	// System counter value
+	uint32_t	cpu;
+	void		(*handler)(struct hrtimer *timer);
+}hrtimer_t;
+
+// Reply to the READ_HRTIMER_JITTER system read
+typedef struct
+{
+	uint32_t	freq;		// System counter frequency
+	uint32_t	count;
+	uint32_t	max;		// Deadline to handler, in system counter ticks
+	uint32_t	buckets[HRTIMER_JITTER_BUCKETS];
+}hrtimer_jitter_t;
+
+
+/* Exported macros ---------------------------------------- */
+
+
+
+/* Exported functions ------------------------------------- */
+
+/*
+ * @brief   Initialize the per cpu timer queues
+ * @param   None
+ * @retval  No return
+ */
+void HrtimerInit(void);
+
+/*
+ * @brief   Attach the running cpu deadline interrupt, called by each cpu
+ * @param   None
+ * @retval  No return
+ */
+void HrtimerCpuStart(void);
+
+/*
+ * @brief   Start a one-shot timer on the running cpu, restarted if already pending.
+ *          The handler runs in interrupt context
+ * @param   timer - timer
+ *          time - deadline
+ *          mode - HRTIMER_REL or HRTIMER_ABS
+ *          handler - called when the deadline is reached
+ * @retval  Success or E_INVAL
+ */
+int32_t HrtimerStart(hrtimer_t *timer, const timespec_t *time, uint32_t mode, void (*handler)(hrtimer_t *timer));
+
+/*
+ * @brief   Stop a pending timer
+ * @param   timer - timer
+ * @retval  TRUE if it was still pending
+ */
+bool_t HrtimerCancel(hrtimer_t *timer);
+
+/*
+ * @brief   Get the time since boot
+ * @param   time - returns the time
+ * @retval  Success or E_INVAL if the process can't write to time
+ */
+int32_t ClockGetTime(timespec_t *time);
+
+/*
+ * @brief   Copy the timers lateness histogram of all cpus added together
+ * @param   buffer - hrtimer_jitter_t to fill
+ *          size - buffer size
+ *          offset - returns the bytes written
+ * @retval  Success, E_INVAL if the kernel was built without HRTIMER_JITTER
+ */
+int32_t HrtimerJitterRead(char *buffer, size_t size, uint32_t *offset);
+
+#endif /* _HRTIMER_H_ */
@@ -53,6 +53,12 @@ typedef struct
 // with the difference that the name will have also the remaining unresolved path
 // NOTE: best match cannot be combined with namespace entries
 
+// _IO_READ codes to the system
+#define READ_SYSTEM_STATS	0
+#define READ_IRQ_LATENCY	1	// Kernel built with IRQ_LATENCY, replies a latency_info_t
+#define READ_LOCK_STATS		2	// Kernel built with KLOCK_STATS, replies a klock_report_t per lock name
+#define READ_HRTIMER_JITTER	3	// Kernel built with HRTIMER_JITTER, replies a hrtimer_jitter_t
+
 /* Exported macros ---------------------------------------- */
 
 
@@ -52,6 +52,7 @@ typedef struct
 	connection_t* connection;
 	uint16_t      flags;
 	int16_t       refs;
+	int16_t       pulses;  // references held by the interrupts pulsing through it
     sref_t*       privMap;
 	glistNode_t   node;
 }clink_t;
@@ -64,6 +65,7 @@ typedef struct
     int32_t     data;
     int32_t     scoid;
     uint16_t    priority;
+    uint16_t    flags;
 }notify_t;
 
 typedef struct
@@ -110,6 +112,10 @@ typedef struct
 #define _NOTIFY_TASK_UNBLOCK_         (0x3)
 #define _NOTIFY_COID_DEAD_            (0x4)
 
+// Notifications flags
+#define NOTIFY_STATIC                 (1 << 0)    // Owned by the sender, never released by the IPC
+#define NOTIFY_QUEUED                 (1 << 1)    // Pending in the channel notify list
+
 /* Exported macros ---------------------------------------- */
 #define CONNECTION_SCOID(scoid)			(scoid & 0xFFFF)
 #define CONNECTION_CHID(scoid)			(scoid >> 16)
@@ -230,6 +236,28 @@ int32_t MsgRead(int32_t rcvid, const void *msg, size_t size, int32_t offset);
 
 int32_t ker_MsgNotify(connection_t* connection, int32_t priority, int32_t type, int32_t value);
 
+/*
+ * @brief   Send a preallocated notification, safe to be called from interrupt context.
+ *          A notification still pending in the channel is not queued again, pulses
+ *          sent before the receiver gets it are coalesced
+ *
+ * @param   connection - connection the notification is sent through
+ *          notify - notification with type, data and priority set and NOTIFY_STATIC flag
+ *
+ * @retval  Return success, E_INVAL if the connection or the channel are gone
+ */
+int32_t ker_MsgPulse(connection_t* connection, notify_t* notify);
+
+/*
+ * @brief   Remove a preallocated notification from the channel if still pending
+ *
+ * @param   connection - connection the notification was sent through
+ *          notify - notification
+ *
+ * @retval  No return
+ */
+void ker_MsgPulseCancel(connection_t* connection, notify_t* notify);
+
 /*
  * @brief   System call to send a notification through an IPC channel
  *
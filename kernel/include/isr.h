@@ -17,6 +17,7 @@
 /* Includes ----------------------------------------------- */
 #include <types.h>
 #include <proctypes.h>
+#include <ipc_2.h>
 
 /* Exported constants ------------------------------------- */
 
@@ -31,6 +32,10 @@ typedef struct
 		uint16_t	target;
 		uint8_t		priority;
 		uint8_t		enable;
+		uint32_t	affinity;	// Cpus the interrupt can be forwarded to
+		uint32_t	count;		// Interrupts received
+		uint32_t	sample;		// Count on the last balance
+		uint32_t	load;		// Received in the last balance period
 	}interrupt;
 
 	struct
@@ -41,6 +46,9 @@ typedef struct
 		void		*(*handler)(void*, uint32_t);
 		int16_t		set;
 		int16_t		pending;
+		int16_t		masked;		// Masked by the kernel until the task waits again
+		clink_t		*link;		// Pulse delivery, connection the pulse is sent through
+		notify_t	pulse;
 	}attach;
 
 } isr_t;
@@ -51,20 +59,72 @@ typedef struct
 #define INTERRUPT_INVALID			(-1)
 #define SCHEDULER_IRQ				(0)
 
+// System ticks between interrupts balancing, kernel built with INTERRUPT_BALANCER
+#ifndef INTERRUPT_BALANCE_PERIOD
+#define INTERRUPT_BALANCE_PERIOD	(100)
+#endif
+
 /* Exported functions ------------------------------------- */
 
 int32_t InterruptHandlerInit();
 
+/*
+ * @brief   Attach the running task to an interrupt. Kernel handlers (no running task)
+ *          are called from the interrupt, for a task the interrupt is masked and the
+ *          task is woken up from InterruptWait, it runs its handler in its own context
+ */
 int32_t InterruptAttach (int32_t intr, uint8_t priority, void *(*handler)(void *, uint32_t), const void *area);
 
+/*
+ * @brief   Attach an interrupt to be delivered as a pulse through the connection coid
+ *          of the running process. The pulse is allocated here and sent from the
+ *          interrupt, the interrupt stays masked until InterruptUnmask is called.
+ *          A task can attach any number of interrupts this way and receive them
+ *          along with its messages in MsgReceive
+ * @param   intr - interrupt number
+ *          priority - interrupt priority
+ *          coid - connection to the channel receiving the pulse
+ *          type - pulse type
+ *          value - pulse data
+ * @retval  Interrupt id or error
+ */
+int32_t InterruptAttachPulse(int32_t intr, uint8_t priority, int32_t coid, int32_t type, int32_t value);
+
 int32_t InterrupDetach(int32_t id);
 
+/*
+ * @brief   Detach all interrupts a process attached to be delivered as pulses.
+ *          Has to be called before the process connections are closed
+ */
+void InterruptProcessClean(process_t *process);
+
 int32_t InterruptClean(task_t *task);
 
 int32_t InterruptMask( int32_t intr, int32_t id );
 
 int32_t InterruptUnmask( int32_t intr, int32_t id );
 
+/*
+ * @brief   Set the cpus a shared interrupt can be forwarded to. The interrupt is
+ *          forwarded to one cpu of the mask, the balancer only moves it inside it
+ * @param   intr - interrupt number
+ *          id - interrupt id returned by the attach
+ *          mask - cpu mask, bit n for cpu n
+ * @retval  Return success
+ */
+int32_t InterruptAffinity(int32_t intr, int32_t id, uint32_t mask);
+
+/*
+ * @brief   Spread the busy shared interrupts across the cpus using the interrupts
+ *          received since the last call. Called from the system tick, does the
+ *          work every INTERRUPT_BALANCE_PERIOD calls
+ */
+void InterruptBalance(void);
+
+/*
+ * @brief   Wait for the attached interrupt. An interrupt masked by its delivery is
+ *          unmasked before waiting, the task is done with the previous one
+ */
 int32_t InterruptWait(int32_t id);
 
 #ifdef __cplusplus
@@ -13,20 +13,53 @@
 /* Includes ----------------------------------------------- */
 #include <types.h>
 
+#if defined(KLOCK_TORTURE) || defined(KLOCK_STATS)
+#include <arch.h>
+#endif
+
 
 /* Exported types ----------------------------------------- */
 typedef struct
 {
     uint32_t count;
     uint32_t owner;
+    uint32_t ticket;    // Next ticket in the upper half, ticket being served in the lower half
+#ifdef KLOCK_STATS
+    struct klock_class* stats;      // Locks with the same name are accounted together
+    uint32_t since;                 // Cycles when the owner took it
+#endif
 }klock_t;
 
+// Reply to the READ_LOCK_STATS system read, one per lock name. Times in cpu cycles
+typedef struct
+{
+    char     name[16];
+    uint32_t acquired;
+    uint32_t contended;     // Had to wait for another cpu
+    uint32_t spinMax;
+    uint32_t holdMax;       // Not measured for spin locks
+    uint64_t spinTotal;
+}klock_report_t;
+
+#ifdef KLOCK_TORTURE
+typedef struct
+{
+    uint32_t cpus;
+    uint32_t total;                 // Acquisitions by all cpus
+    uint32_t cycles;                // Cycles taken by the slowest cpu
+    uint32_t acquired[MAX_CPUS];    // Acquisitions by each cpu
+}klock_torture_t;
+#endif
+
 
 /* Exported constants ------------------------------------- */
 
 
 /* Exported macros ---------------------------------------- */
 
+#ifndef KLOCK_STATS
+#define KlockName(lock, name)
+#endif
 
 
 /* Exported functions ------------------------------------- */
@@ -45,7 +78,8 @@ void KlockInit(klock_t* lock);
  *          Will ensure that interrupts are disabled and if requested save
  *          the previous interrupt status.
  *          NOTE: This lock is recursive, so lock attempts by the same cpu
- *          will increase the internal counter and be granted access
+ *          will increase the internal counter and be granted access.
+ *          Other cpus take a ticket and get the lock in the order they asked for it
  *
  * @param   lock - in kernel lock
  * 			status - variable to save current interrupt status
@@ -80,5 +114,43 @@ void Kunlock(klock_t* lock, uint32_t* status);
  */
 void KlockEnsure(klock_t* lock, uint32_t* status);
 
+#ifdef KLOCK_STATS
+/*
+ * @brief   Name a lock for the contention profiling, locks with the same name
+ *          are accounted together. Has to be called after KlockInit
+ *
+ * @param   lock - in kernel lock
+ * 			name - lock name, has to stay valid
+ *
+ * @retval  No return
+ */
+void KlockName(klock_t* lock, const char* name);
+#endif
+
+/*
+ * @brief   Copy the contention profiling of every lock name, spin locks are
+ *          accounted together under "spinlock"
+ *
+ * @param   buffer - klock_report_t array to fill
+ * 			size - buffer size
+ * 			offset - returns the bytes written
+ *
+ * @retval  Success or E_INVAL if built without KLOCK_STATS
+ */
+int32_t KlockStatsRead(char* buffer, size_t size, uint32_t* offset);
+
+#ifdef KLOCK_TORTURE
+/*
+ * @brief   Lock torture benchmark. Has to be called by every cpu, they all take
+ *          the same lock until KLOCK_TORTURE_ROUNDS acquisitions are done
+ *
+ * @param   result - filled on the boot cpu once all cpus are done, can be NULL
+ * 			on the others
+ *
+ * @retval  No return
+ */
+void KlockTorture(klock_torture_t* result);
+#endif
+
 
 #endif /* _KLOCK_H_ */
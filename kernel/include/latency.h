@@ -0,0 +1,125 @@
+/**
+ * @file        latency.h
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        18 October, 2026
+ * @brief       Interrupt Latency Instrumentation Header File
+*/
+
+#ifndef _LATENCY_H
+#define _LATENCY_H
+
+
+/* Includes ----------------------------------------------- */
+#include <types.h>
+#include <proctypes.h>
+
+
+/* Exported constants ------------------------------------- */
+
+// Measured intervals, in system counter ticks
+#define LATENCY_ACK_DISPATCH		(0)		// Interrupt acknowledge to the kernel handling it
+#define LATENCY_DISPATCH_WAKEUP		(1)		// Handling to a task being woken up by it
+#define LATENCY_WAKEUP_RUN			(2)		// Task woken up by an interrupt to it running
+#define LATENCY_IRQ_OFF				(3)		// Spans with interrupts disabled
+#define LATENCY_HISTOGRAMS			(4)
+
+// Bucket n counts samples in [2^n, 2^(n+1)), bucket 0 also counts zero
+#define LATENCY_BUCKETS				(32)
+
+
+/* Exported types ----------------------------------------- */
+
+typedef struct
+{
+	uint32_t	count;
+	uint32_t	max;
+	uint32_t	buckets[LATENCY_BUCKETS];
+}latency_hist_t;
+
+// Reply to the READ_IRQ_LATENCY system read
+typedef struct
+{
+	uint32_t		freq;		// System counter frequency
+	latency_hist_t	hist[LATENCY_HISTOGRAMS];
+}latency_info_t;
+
+// Interrupt being handled, lives in the handler stack so nested interrupts keep their own
+typedef struct latency_irq
+{
+	uint32_t			ack;
+	uint32_t			dispatch;
+	struct latency_irq	*outer;
+}latency_irq_t;
+
+
+/* Exported macros ---------------------------------------- */
+
+
+
+/* Exported functions ------------------------------------- */
+
+/*
+ * The hooks are only called by kernels built with IRQ_LATENCY, without it
+ * nothing is measured and LatencyRead fails
+ */
+
+/*
+ * @brief   Start measuring an acknowledged interrupt
+ * @param   irq - interrupt frame
+ * @retval  No return
+ */
+void LatencyIrqEnter(latency_irq_t *irq);
+
+/*
+ * @brief   The kernel is handling the interrupt of the running cpu
+ * @param   None
+ * @retval  No return
+ */
+void LatencyIrqDispatch(void);
+
+/*
+ * @brief   End of the interrupt handling
+ * @param   irq - interrupt frame
+ * @retval  No return
+ */
+void LatencyIrqExit(latency_irq_t *irq);
+
+/*
+ * @brief   A task is made ready, measured if done while handling an interrupt
+ * @param   task - task woken up
+ * @retval  No return
+ */
+void LatencyTaskWakeup(task_t *task);
+
+/*
+ * @brief   A task was picked to run
+ * @param   task - task about to run
+ * @retval  No return
+ */
+void LatencyTaskRun(task_t *task);
+
+/*
+ * @brief   Interrupts were disabled, called from critical_lock
+ * @param   None
+ * @retval  No return
+ */
+void LatencyIrqOff(void);
+
+/*
+ * @brief   Interrupts are about to be enabled, called from critical_unlock
+ * @param   None
+ * @retval  No return
+ */
+void LatencyIrqOn(void);
+
+/*
+ * @brief   Copy the histograms of all cpus added together
+ * @param   buffer - latency_info_t to fill
+ *          size - buffer size
+ *          offset - returns the bytes written
+ * @retval  Success
+ */
+int32_t LatencyRead(char *buffer, size_t size, uint32_t *offset);
+
+#endif /* _LATENCY_H */
@@ -32,6 +32,7 @@ typedef struct
 		vaddr_t		addr;
 		size_t		size;
 		glist_t 	memory;
+		bool_t		xip;		// memory belongs to the RFS, don't release it
 	}text;
 
 	struct
@@ -46,6 +47,16 @@ typedef struct
 		size_t		size;
 	}bss;
 
+	// Writable segment (.data + .bss). The .data file pages are loaded once
+	// and shared copy on write by every process running the image
+	struct
+	{
+		vaddr_t		addr;
+		uint32_t	pages;
+		uint32_t	filePages;
+		paddr_t		*pristine;
+	}image;
+
 }loadInf_t;
 
 typedef struct
@@ -54,7 +65,9 @@ typedef struct
 
 	struct
 	{
-		glist_t 	dataMemory;
+		// Process own copy of each writable segment page, NULL while the
+		// page is still shared with the image or was never touched
+		paddr_t		*pages;
 	}private;
 
 }exec_t;
@@ -29,12 +29,25 @@ typedef struct
 	glist_t		lockQueue;
 	task_t		*owner;
 	glistNode_t tnode;
+	uint32_t	*word;		// User lock word this wait queue is for, NULL for kernel mutexs
 }mutex_t;
 
 
 /* Exported constants ------------------------------------- */
 #define MUTEX_INITIALIZER	0x10101010
 
+/*
+ * User lock word, taken and released in user space with ldrex/strex:
+ *   lock   - cmp_set(word, MUTEX_WORD_FREE, MUTEX_WORD_OWNER(tid)), MutexWordLock if it fails
+ *   unlock - cmp_set(word, MUTEX_WORD_OWNER(tid), MUTEX_WORD_FREE), MutexWordUnlock if it fails
+ * The kernel sets MUTEX_WORD_WAITERS when a task blocks on the word so the owner
+ * unlock fails in user space and enters the kernel to hand over the lock
+ */
+#define MUTEX_WORD_FREE				(0x0)
+#define MUTEX_WORD_WAITERS			(1UL << 31)
+#define MUTEX_WORD_OWNER_MASK		(0x1FFFF)
+#define MUTEX_WORD_OWNER(tid)		(((tid) & 0xFFFF) + 1)
+
 
 /* Exported macros ---------------------------------------- */
 
@@ -54,10 +67,66 @@ int32_t MutexUnlock(mutex_t *mutex);
 
 int32_t MutexTrylock(mutex_t *mutex);
 
+/*
+ * @brief   Release the mutex and block the running task on a condition variable
+ *          queue. Both are done under the mutex lock so a signaller can't miss it
+ * @param   mutex - mutex owned by the running task
+ *          queue - condition variable queue
+ *          timeout - handler if the task has a timeout set
+ *          arg - timeout handler argument
+ * @retval  Success, E_TIMED_OUT or E_INVAL if not the owner. On success the task
+ *          owns the mutex again
+ */
+int32_t MutexCondWait(mutex_t *mutex, glist_t *queue, void (*timeout)(void*,task_t*), void *arg);
+
+/*
+ * @brief   Wake up tasks waiting on a condition variable. If the mutex is free the
+ *          first task gets it and runs, the others are moved to the mutex queue and
+ *          get it in turn as it is released instead of all waking up to contend
+ * @param   mutex - mutex the condition variable is used with
+ *          queue - condition variable queue
+ *          count - tasks to wake up, 0 for all
+ * @retval  Number of tasks made ready
+ */
+int32_t MutexCondRequeue(mutex_t *mutex, glist_t *queue, int32_t count);
+
+/*
+ * @brief   Initialize the wait queues used by the user lock words
+ * @param   None
+ * @retval  No return
+ */
+void MutexWordInit(void);
+
+/*
+ * @brief   Contended lock of a user lock word. Takes the word if it was released
+ *          meanwhile otherwise marks it with waiters and blocks until the owner
+ *          hands it over. The owner inherits the task priority
+ * @param   word - user lock word
+ * @retval  Success, E_TIMED_OUT if a timeout was set or E_INVAL
+ */
+int32_t MutexWordLock(uint32_t *word);
+
+/*
+ * @brief   Unlock of a user lock word with waiters. The lock is handed over to
+ *          the highest priority waiter
+ * @param   word - user lock word owned by the running task
+ * @retval  Success or E_ERROR if not the owner
+ */
+int32_t MutexWordUnlock(uint32_t *word);
+
 int32_t MutexListSort(glistNode_t* current, glistNode_t* newmutex);
 
 void MutexPriorityResolve(mutex_t* mutex, task_t* task, uint16_t prio);
 
+/*
+ * @brief   Get how many times a locker spun waiting for an owner running on
+ *          another cpu and how many of those took the lock without blocking
+ * @param   spins - spin attempts
+ *          wins - spins that got the lock
+ * @retval  No return
+ */
+void MutexGetSpinStats(uint32_t *spins, uint32_t *wins);
+
 void MutexPriorityAdjust(task_t* task, uint16_t prio);
 
 #endif /* _MUTEX_H_ */
@@ -126,6 +126,78 @@ task_t *ProcessGetTask(process_t *process, uint32_t tid);
 
 vaddr_t ProcessRegisterPrivMemory(process_t *process, mbv_t *memory, int32_t parts, size_t size, memCfg_t *memcfg);
 
+/*
+ * @brief   Routine to reserve private memory in the process mmap area without
+ *          allocating it. Pages are allocated and zeroed on first access
+ *
+ * @param   process - process handler structure
+ *          size - size of the memory area
+ *          memcfg - mapping configuration
+ *
+ * @retval  Base virtual address of the reserved area or NULL on error
+ */
+vaddr_t ProcessReservePrivMemory(process_t *process, size_t size, memCfg_t *memcfg);
+
+/*
+ * @brief   Routine to handle a data fault in the process address space.
+ *          If the address belongs to an on demand private object the page is
+ *          allocated and mapped. Faults on the .data/.bss segment give the
+ *          process its own copy of the page
+ *
+ * @param   process - process handler structure
+ *          addr - faulting virtual address
+ *          protection - TRUE for a write to a present read only page, FALSE
+ *                       for a missing translation
+ *
+ * @retval  E_OK if the page is now mapped, error otherwise
+ */
+int32_t ProcessPageFault(process_t *process, vaddr_t addr, bool_t protection);
+
+/*
+ * @brief   Routine to allocate all the missing pages of an on demand private object
+ *
+ * @param   process - process handler structure
+ *          obj - private memory object
+ *
+ * @retval  Success
+ */
+int32_t ProcessPopulatePrivObject(process_t *process, pobj_t *obj);
+
+/*
+ * @brief   Routine to translate a process virtual address into a physical address.
+ *          Pages of on demand objects not yet allocated are faulted in, when
+ *          the kernel is going to write to it shared .data pages are copied
+ *
+ * @param   process - process handler structure
+ *          addr - virtual address
+ *          write - TRUE if the kernel will write to the address
+ *
+ * @retval  Physical address or NULL if the address is not valid
+ */
+paddr_t ProcessVirtual2Physical(process_t *process, vaddr_t addr, bool_t write);
+
+/*
+ * @brief   Check a user word the kernel is going to change for the process,
+ *          the page is faulted in or copied like for ProcessVirtual2Physical
+ *
+ * @param   process - process handler structure
+ *          word - user address
+ *
+ * @retval  TRUE if it is aligned and the process can write to it
+ */
+bool_t ProcessUserWordValid(process_t *process, uint32_t *word);
+
+/*
+ * @brief   Check a user word the kernel is going to read for the process,
+ *          the page is faulted in if it wasn't touched yet
+ *
+ * @param   process - process handler structure
+ *          word - user address
+ *
+ * @retval  TRUE if it is aligned and the process can read it
+ */
+bool_t ProcessUserWordReadable(process_t *process, const uint32_t *word);
+
 sref_t* ProcessRegisterShareMemory(process_t* process, uint32_t coid, sobj_t* sobj, memCfg_t* memcfg);
 
 dev_obj_t *ProcessRegisterDevice(process_t *process, dev_t *device, memCfg_t *memcfg);
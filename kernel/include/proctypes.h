@@ -21,7 +21,9 @@
 #include <allocator.h>
 #include <vstack.h>
 #include <vmap.h>
+#include <asid.h>
 #include <loader.h>
+#include <hrtimer.h>
 
 
 /* Exported types ----------------------------------------- */
@@ -64,6 +66,10 @@ typedef struct TASK
     uint16_t    active_prio;    // task active priority
     uint32_t    flags;          // Detached, Privilege Level
     uint64_t    on_time;        // task cpu time used
+    uint32_t    rcuNest;        // rcu read sections entered, not preempted while in one
+#ifdef IRQ_LATENCY
+    uint32_t    wakeup;         // woken up by an interrupt at, system counter
+#endif
 
     glistNode_t node;           // node used to add task to block lists
     void*       block_on;       // where task is blocked
@@ -116,7 +122,8 @@ typedef struct TASK
         glistNode_t node;
         void (*handler)(void*, task_t*);
         void*       arg;
-        uint32_t    pendTime;   // pending time till wake up
+        uint32_t    pendTime;   // tick to wake up at
+        hrtimer_t   hrtimer;    // used instead of the tick for TIMER_HIGH_RES and NanoSleep
     }timeout;
 
     struct
@@ -170,6 +177,8 @@ typedef struct PROCESS
 	{
 		// Process page table
 		pgt_t		pgt;
+		// Address space id used by the TLB
+		asid_t		asid;
 		// Memory Statistics
 		uint32_t	memUsed;
 		// Process Local Storage
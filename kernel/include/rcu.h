@@ -0,0 +1,97 @@
+/**
+ * @file        rcu.h
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        18 October, 2026
+ * @brief       Read-Copy-Update Definition Header File
+*/
+
+#ifndef _RCU_H_
+#define _RCU_H_
+
+
+/* Includes ----------------------------------------------- */
+#include <types.h>
+
+
+/* Exported constants ------------------------------------- */
+
+
+
+/* Exported types ----------------------------------------- */
+
+// Embedded in an object that has to outlive its readers
+typedef struct rcu_head
+{
+	struct rcu_head	*next;
+	void			(*func)(struct rcu_head *head);
+}rcu_head_t;
+
+
+/* Exported macros ---------------------------------------- */
+
+
+
+/* Exported functions ------------------------------------- */
+
+/*
+ * Readers look up objects without any lock, writers unlink them and defer
+ * the release until every cpu passed a quiescent point. A cpu is quiescent
+ * when it schedules at the top interrupt level or blocks a task that is not
+ * inside a read section, the scheduler doesn't preempt a task inside one
+ */
+
+/*
+ * @brief   Initialize the grace periods tracking
+ * @param   cpus - number of cpus taking part
+ * @retval  No return
+ */
+void RcuInit(uint32_t cpus);
+
+/*
+ * @brief   Enter a read section, the objects looked up stay valid until it
+ *          is left. Task context only, can be nested and must not block
+ * @param   None
+ * @retval  No return
+ */
+void RcuReadLock(void);
+
+/*
+ * @brief   Leave a read section
+ * @param   None
+ * @retval  No return
+ */
+void RcuReadUnlock(void);
+
+/*
+ * @brief   Call func once the readers that could see the object are done.
+ *          The callbacks run from the scheduler interrupt or a later RcuCall
+ * @param   head - object rcu head
+ *          func - release function
+ * @retval  No return
+ */
+void RcuCall(rcu_head_t *head, void (*func)(rcu_head_t *head));
+
+/*
+ * @brief   kfree the memory once the readers that could see it are done
+ * @param   ptr - memory to free
+ *          size - memory size
+ * @retval  No return
+ */
+void RcuFree(void *ptr, size_t size);
+
+/*
+ * @brief   The running cpu passed a quiescent point, called by the scheduler
+ * @param   None
+ * @retval  No return
+ */
+void RcuQuiescent(void);
+
+/*
+ * @brief   Run the callbacks whose grace period ended
+ * @param   None
+ * @retval  No return
+ */
+void RcuReclaim(void);
+
+#endif /* _RCU_H_ */
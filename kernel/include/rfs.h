@@ -51,4 +51,15 @@ char* RfsGetMach();
 
 int32_t RfsGet(vaddr_t *addr, size_t *size);
 
+/*
+ * @brief   Check if a physical memory range is part of the RFS image. Memory
+ *          in the RFS is never released so it can be mapped directly
+ *
+ * @param   addr - physical address
+ *          size - range size
+ *
+ * @retval  TRUE if the whole range is inside the RFS
+ */
+bool_t RfsContains(paddr_t addr, size_t size);
+
 #endif /* _RFS_H_ */
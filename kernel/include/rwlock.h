@@ -12,18 +12,35 @@
 
 /* Includes ----------------------------------------------- */
 #include <types.h>
+#include <arch.h>
+
+
+/* Exported constants ------------------------------------- */
+#define NO_WRITER   ((uint32_t)(-1))
+
+// Largest L1 data cache line of the supported cores
+#define BRLOCK_LINE_SIZE    (64)
 
 
 /* Exported types ----------------------------------------- */
+
+// Readers count with the writer flag set while a writer holds it
 typedef struct
 {
-    int32_t  readers;
-    uint32_t writer;
+    uint32_t state;
+    uint32_t writer;    // Cpu holding it for writing, can also read it
 }rwlock_t;
 
-
-/* Exported constants ------------------------------------- */
-#define NO_WRITER   ((uint32_t)(-1))
+// Big reader lock, each cpu readers count in its own cache line so readers never
+// share one. A waiting writer stops new readers from getting in
+typedef struct
+{
+    struct
+    {
+        int32_t readers;
+    }__attribute__((aligned(BRLOCK_LINE_SIZE))) cpu[MAX_CPUS];
+    uint32_t writer;
+}__attribute__((aligned(BRLOCK_LINE_SIZE))) brlock_t;
 
 
 /* Exported macros ---------------------------------------- */
@@ -42,7 +59,10 @@ typedef struct
 void RWlockInit(rwlock_t* lock);
 
 /*
- * @brief   Acquire read access
+ * @brief   Acquire read access. Interrupts are disabled until the last read
+ * 			access of the cpu is released so a writer in an interrupt handler
+ * 			can't wait on the reader it interrupted. Read access can be nested
+ * 			and taken by the cpu holding write access
  *
  * @param   lock
  *
@@ -81,5 +101,58 @@ void WriteLock(rwlock_t* lock, uint32_t* status);
  */
 void WriteUnlock(rwlock_t* lock, uint32_t* status);
 
+/*
+ * @brief   Initialize the big reader lock
+ *
+ * @param   lock
+ *
+ * @retval  No return
+ */
+void BrlockInit(brlock_t* lock);
+
+/*
+ * @brief   Acquire read access. Only the running cpu readers count is changed
+ * 			and waits while a writer holds or waits for the lock, so it can't be
+ * 			taken again by a cpu already reading it. Interrupts are disabled
+ * 			like for ReadLock so the task can't move to another cpu and a writer
+ * 			in an interrupt handler can't wait on the reader it interrupted
+ *
+ * @param   lock
+ *
+ * @retval  No return
+ */
+void BrReadLock(brlock_t* lock);
+
+/*
+ * @brief   Release read access, only signals other cpus if a writer is waiting
+ *
+ * @param   lock
+ *
+ * @retval  No return
+ */
+void BrReadUnlock(brlock_t* lock);
+
+/*
+ * @brief   Acquire write access, waits for the readers of every cpu to leave.
+ * 			Interrupts will be disabled
+ *
+ * @param   lock
+ * 			status
+ *
+ * @retval  No return
+ */
+void BrWriteLock(brlock_t* lock, uint32_t* status);
+
+/*
+ * @brief   Release write access.
+ * 			Interrupts will be restored
+ *
+ * @param   lock
+ * 			status
+ *
+ * @retval  No return
+ */
+void BrWriteUnlock(brlock_t* lock, uint32_t* status);
+
 
 #endif /* _RWLOCK_H_ */
@@ -132,6 +132,46 @@ void* SchedIrqExit();
 
 void* SchedTerminateRunningTask();
 
+/*
+ * @brief   Routine to get the TLB refills counted by the cpus PMUs at
+ *          schedule points since boot
+ *
+ * @param   No Parameters
+ *
+ * @retval  Number of data and instruction TLB refills
+ */
+uint32_t SchedGetTlbRefills();
+
+/*
+ * @brief   Routine to load the process translations in the running cpu MMU.
+ *          Nothing is done when the cpu already has the process translations
+ *
+ * @param   process - process to switch to, NULL for kernel tasks
+ *
+ * @retval  No return
+ */
+void SchedVirtualSpaceSet(process_t* process);
+
+/*
+ * @brief   Routine to forget a terminating process translations loaded in the cpus
+ *
+ * @param   process - terminating process
+ *
+ * @retval  No return
+ */
+void SchedVirtualSpaceDrop(process_t* process);
+
+/*
+ * @brief   Routine to get the address space switches statistics
+ *
+ * @param   switches - number of switches done
+ *          skips - number of switches avoided since the translations were loaded
+ *          cycles - average cycles spent in a switch
+ *
+ * @retval  No return
+ */
+void SchedGetSwitchStats(uint32_t* switches, uint32_t* skips, uint32_t* cycles);
+
 void PriorityResolve(task_t* task, uint16_t prio);
 
 #endif /* _SCHEDULER_H_ */
@@ -27,11 +27,22 @@ typedef struct
 	int32_t	    counter;
 	spinlock_t	spinLock;
 	glist_t		lockQueue;
+	uint32_t	*word;		// User semaphore word this wait queue is for, NULL for kernel semaphores
 }sem_t;
 
 
 /* Exported constants ------------------------------------- */
 
+/*
+ * User semaphore word, the count is changed in user space with ldrex/strex:
+ *   wait - cmp_set(word, n, n - 1) while the count n > 0, SemWordWait if it is 0
+ *   post - cmp_set(word, n, n + 1) while SEM_WORD_WAITERS is clear, SemWordPost otherwise
+ * The kernel sets SEM_WORD_WAITERS when a task blocks on the word so posts enter
+ * the kernel and hand the unit straight to a waiter instead of incrementing the count
+ */
+#define SEM_WORD_WAITERS			(1UL << 31)
+#define SEM_WORD_COUNT_MASK			(0x7FFFFFFF)
+
 
 /* Exported macros ---------------------------------------- */
 
@@ -51,4 +62,27 @@ int32_t SemPost(sem_t *sem);
 
 int32_t SemDestroy(sem_t *sem);
 
+/*
+ * @brief   Initialize the wait queues used by the user semaphore words
+ * @param   None
+ * @retval  No return
+ */
+void SemWordInit(void);
+
+/*
+ * @brief   Contended wait on a user semaphore word. Takes a unit if one was posted
+ *          meanwhile otherwise marks the word with waiters and blocks until a post
+ * @param   word - user semaphore word
+ * @retval  Success, E_TIMED_OUT if a timeout was set, E_NO_MEMORY or E_INVAL
+ */
+int32_t SemWordWait(uint32_t *word);
+
+/*
+ * @brief   Post on a user semaphore word with waiters. The unit goes to the highest
+ *          priority waiter, the count is only incremented if there is none
+ * @param   word - user semaphore word
+ * @retval  Success, E_NO_RES if the count would overflow or E_INVAL
+ */
+int32_t SemWordPost(uint32_t *word);
+
 #endif /* _SEMAPHORE_H_ */
@@ -18,6 +18,7 @@
 /* Exported constants ------------------------------------- */
 #define TIMER_NO_RELOAD		(0x0)
 #define TIMER_AUTO_RELOAD   (0x1)
+#define TIMER_HIGH_RES      (0x2)   // Wait time in microseconds, doesn't wait for the tick
 
 
 /* Exported types ----------------------------------------- */
@@ -64,4 +65,12 @@ void TimerSet(task_t* task, void (*handler)(void*,task_t*), void* arg);
 
 void TimerStop(task_t* task);
 
+/*
+ * @brief   Put the running task to sleep with the cpu deadline timer
+ * @param   time - sleep time
+ *          mode - HRTIMER_REL or HRTIMER_ABS for a deadline since boot
+ * @retval  Success or E_INVAL
+ */
+int32_t NanoSleep(const timespec_t *time, uint32_t mode);
+
 #endif /* _SLEEP_H */
@@ -17,6 +17,7 @@
 #include <string.h>
 #include <vector.h>
 #include <spinlock.h>
+#include <rcu.h>
 
 
 /* Private types ------------------------------------------ */
@@ -107,8 +108,24 @@ int32_t MsgGet(channel_t* channel, task_t* rcv)
 
 	if(notify != NULL && ((send == NULL) || (send->active_prio <= notify->priority)))
 	{
-		rcv->data.notify.notification = notify;
 		GlistRemoveSpecific(&notify->node);
+
+		if(notify->flags & NOTIFY_STATIC)
+		{
+			// The sender owns it and can send it again as soon as it leaves the list,
+			// copy it while we hold the channel lock
+			rcv->active_prio = notify->priority;
+			rcv->data.notify.data = notify->data;
+			rcv->data.notify.scoid = notify->scoid;
+			rcv->data.notify.type = notify->type;
+			rcv->data.notify.notification = NULL;
+			notify->flags &= ~NOTIFY_QUEUED;
+		}
+		else
+		{
+			rcv->data.notify.notification = notify;
+		}
+
 		return NOTIFY_RCVID;
 	}
 
@@ -140,6 +157,49 @@ void MsgsFlushByScoid(glist_t* list, int32_t scoid, process_t* process)
 	}
 }
 
+void NotifyFlushByScoid(glist_t* list, int32_t scoid)
+{
+	notify_t* notify = GLIST_FIRST(list, notify_t, node);
+
+	while(notify != NULL)
+	{
+		notify_t* next = GLIST_NEXT(&notify->node, notify_t, node);
+
+		if(notify->scoid == scoid)
+		{
+			GlistRemoveSpecific(&notify->node);
+
+			if(notify->flags & NOTIFY_STATIC)
+			{
+				notify->flags &= ~NOTIFY_QUEUED;
+			}
+			else
+			{
+				kfree(notify, sizeof(notify_t));
+			}
+		}
+
+		notify = next;
+	}
+}
+
+void NotifyFlush(glist_t* list)
+{
+	while(!GLIST_EMPTY(list))
+	{
+		notify_t* notify = GLISTNODE2TYPE(GlistRemoveFirst(list), notify_t, node);
+
+		if(notify->flags & NOTIFY_STATIC)
+		{
+			notify->flags &= ~NOTIFY_QUEUED;
+		}
+		else
+		{
+			kfree(notify, sizeof(notify_t));
+		}
+	}
+}
+
 void MsgsFlush(glist_t* list)
 {
 	while(!GLIST_EMPTY(list))
@@ -180,8 +240,18 @@ void ChannelPriorityResolve(channel_t* channel, task_t* task, uint16_t prio)
 	uint32_t status;
 	Klock(&channel->lock, &status);
 
+	// The channel process can be on its way out
+	RcuReadLock();
+
 	process_t* process = ProcGetProcess(channel->pid);
 
+	if(process == NULL)
+	{
+		RcuReadUnlock();
+		Kunlock(&channel->lock, &status);
+		return;
+	}
+
 	if(task->subState == IPC_SEND)
 	{
 		// Reinsert task
@@ -202,6 +272,9 @@ void ChannelPriorityResolve(channel_t* channel, task_t* task, uint16_t prio)
 		// Just change receiver task priority
 		PriorityResolve(task->data.msg.server, prio);
 	}
+
+	RcuReadUnlock();
+	Kunlock(&channel->lock, &status);
 }
 
 void ChannelPriorityAdjust(task_t* task, uint16_t prio)
@@ -216,8 +289,18 @@ void ChannelPriorityAdjust(task_t* task, uint16_t prio)
 	uint32_t status;
 	Klock(&channel->lock, &status);
 
+	// The channel process can be on its way out
+	RcuReadLock();
+
 	process_t* process = ProcGetProcess(channel->pid);
 
+	if(process == NULL)
+	{
+		RcuReadUnlock();
+		Kunlock(&channel->lock, &status);
+		return;
+	}
+
 	if(task->subState == IPC_SEND)
 	{
 		// Reinsert task
@@ -238,6 +321,9 @@ void ChannelPriorityAdjust(task_t* task, uint16_t prio)
 		// Just change receiver task priority
 		PriorityResolve(task->data.msg.server, prio);
 	}
+
+	RcuReadUnlock();
+	Kunlock(&channel->lock, &status);
 }
 
 /*
@@ -300,13 +386,13 @@ uint32_t MsgDirectCopy(const char* send, size_t sbytes, uint32_t soff, const cha
     return copySize;
 }
 
-uint32_t MsgMapReceiverCopy(const char* send, uint32_t sendOff, const char* recv, uint32_t rcvOff, pgt_t rcvPgt, size_t size)
+uint32_t MsgMapReceiverCopy(const char* send, uint32_t sendOff, const char* recv, uint32_t rcvOff, process_t* receiver, size_t size)
 {
 	// Apply offset to the original receiver address
 	vaddr_t vcopyAddr = (vaddr_t)((uint32_t)recv + rcvOff);
 
 	// Get physical address to where we want to copy data
-	paddr_t p_rcv = MemoryVirtual2physical(rcvPgt, (vaddr_t)vcopyAddr);
+	paddr_t p_rcv = ProcessVirtual2Physical(receiver, (vaddr_t)vcopyAddr, TRUE);
 
 	// Get the physical address aligned to a PAGE boundary
 	paddr_t bp_rcv =  (paddr_t)(ALIGN_DOWN((uint32_t)p_rcv, PAGE_SIZE));
@@ -331,19 +417,19 @@ uint32_t MsgMapReceiverCopy(const char* send, uint32_t sendOff, const char* recv
 		addrOff = 0;
 		vcopyAddr = (vaddr_t)((uint32_t)vcopyAddr + mapSize);
 		mapSize = (((mapped + PAGE_SIZE) > size) ? (size - mapped) : (PAGE_SIZE));
-		bp_rcv = MemoryVirtual2physical(rcvPgt, (vaddr_t)vcopyAddr);
+		bp_rcv = ProcessVirtual2Physical(receiver, (vaddr_t)vcopyAddr, TRUE);
 	}
 
 	return size;
 }
 
-uint32_t MsgMapSenderCopy(const char* send, uint32_t sendOff, const char* recv, uint32_t rcvOff, pgt_t sendPgt, size_t size)
+uint32_t MsgMapSenderCopy(const char* send, uint32_t sendOff, const char* recv, uint32_t rcvOff, process_t* sender, size_t size)
 {
 	// Apply offset to the original receiver address
 	vaddr_t vcopyAddr = (vaddr_t)((uint32_t)send + sendOff);
 
 	// Get physical address to where we want to copy data
-	paddr_t p_send = MemoryVirtual2physical(sendPgt, (vaddr_t)vcopyAddr);
+	paddr_t p_send = ProcessVirtual2Physical(sender, (vaddr_t)vcopyAddr, FALSE);
 
 	// Get the physical address aligned to a PAGE boundary
 	paddr_t bp_send =  (paddr_t)(ALIGN_DOWN((uint32_t)p_send, PAGE_SIZE));
@@ -368,7 +454,7 @@ uint32_t MsgMapSenderCopy(const char* send, uint32_t sendOff, const char* recv,
 		addrOff = 0;
 		vcopyAddr = (vaddr_t)((uint32_t)vcopyAddr + mapSize);
 		mapSize = (((mapped + PAGE_SIZE) > size) ? (size - mapped) : (PAGE_SIZE));
-		bp_send = MemoryVirtual2physical(sendPgt, (vaddr_t)vcopyAddr);
+		bp_send = ProcessVirtual2Physical(sender, (vaddr_t)vcopyAddr, FALSE);
 	}
 
 	return size;
@@ -387,7 +473,7 @@ uint32_t MsgCopyFromSender(task_t* sender, char* buffer, size_t size, uint32_t r
 	}
 	else
 	{
-		sender->data.msg.read_off = MsgMapSenderCopy(sender->data.msg.smsg, readOff, buffer, 0, sender->parent->Memory.pgt, MsgCopySize(sender->data.msg.sbytes, 0, size, 0));
+		sender->data.msg.read_off = MsgMapSenderCopy(sender->data.msg.smsg, readOff, buffer, 0, sender->parent, MsgCopySize(sender->data.msg.sbytes, 0, size, 0));
 	}
 
 	return sender->data.msg.read_off;
@@ -406,7 +492,7 @@ uint32_t MsgCopyToSender(task_t* sender, char* buffer, size_t size, uint32_t wri
 	}
 	else
 	{
-		sender->data.msg.write_off = MsgMapReceiverCopy(buffer, 0, sender->data.msg.rmsg, writeOff, sender->parent->Memory.pgt, MsgCopySize(size, 0, sender->data.msg.rbytes, writeOff));
+		sender->data.msg.write_off = MsgMapReceiverCopy(buffer, 0, sender->data.msg.rmsg, writeOff, sender->parent, MsgCopySize(size, 0, sender->data.msg.rbytes, writeOff));
 	}
 
 	return sender->data.msg.write_off;
@@ -489,6 +575,7 @@ int32_t ChannelCreate(uint32_t flags)
 	channel->server = NULL;
 
 	KlockInit(&channel->lock);
+	KlockName(&channel->lock, "channel");
 
 	// Make channel available
 	channel->flags |= CHANNEL_ALIVE;
@@ -512,13 +599,17 @@ int32_t ConnectAttach(pid_t pid, int32_t chid, uint32_t index, uint32_t flags)
 
 	process_t* process = SchedGetRunningProcess();
 
+	// The channel can be destroyed meanwhile, keep its memory till we are done
+	RcuReadLock();
+
 	// Get channel process owner
 	process_t* channelProc = ProcGetProcess(pid);
 	// Get channel
-	channel_t* channel = VectorPeek(&channelProc->channels, (uint32_t)chid);
+	channel_t* channel = ((channelProc != NULL) ? (VectorPeek(&channelProc->channels, (uint32_t)chid)) : (NULL));
 	// Check if the channel is still alive
 	if((channel ==  NULL) || !(channel->flags & CHANNEL_ALIVE))
 	{
+		RcuReadUnlock();
 		return INVALID_COID;
 	}
 
@@ -534,6 +625,7 @@ int32_t ConnectAttach(pid_t pid, int32_t chid, uint32_t index, uint32_t flags)
 			clink_t* link = (clink_t*)VectorPeek(&process->connections, index);
 			if(link != NULL && link->connection->channel == channel)
 			{
+				RcuReadUnlock();
 				link->refs++;
 				return link->coid;
 			}
@@ -546,12 +638,14 @@ int32_t ConnectAttach(pid_t pid, int32_t chid, uint32_t index, uint32_t flags)
 	connection_t* connection = (connection_t*)kmalloc(sizeof(connection_t));
 	if(connection == NULL)
 	{
+		RcuReadUnlock();
 		return INVALID_COID;
 	}
 
 	clink_t* link = (clink_t*)kmalloc(sizeof(clink_t));
 	if(link == NULL)
 	{
+		RcuReadUnlock();
 		kfree(connection, sizeof(connection_t));
 		return INVALID_COID;
 	}
@@ -567,6 +661,7 @@ int32_t ConnectAttach(pid_t pid, int32_t chid, uint32_t index, uint32_t flags)
 	link->connection = connection;
 	link->flags = 0;
 	link->refs = 1;
+	link->pulses = 0;
 	link->privMap = NULL;
 	GlistInsertObject(&connection->clinks, &link->node);
 
@@ -581,6 +676,8 @@ int32_t ConnectAttach(pid_t pid, int32_t chid, uint32_t index, uint32_t flags)
 		ker_MsgNotify(connection, SchedGetRunningTask()->active_prio, _NOTIFY_SCOID_ATTACH_, link->pid);
 	}
 
+	RcuReadUnlock();
+
 	return link->coid;
 }
 
@@ -589,8 +686,11 @@ int32_t ConnectAttach(pid_t pid, int32_t chid, uint32_t index, uint32_t flags)
 */
 int32_t ker_ChannelDestroy(process_t* process, channel_t* channel)
 {
-	// Signal that this channel is no longer alive
+	// Signal that this channel is no longer alive, pulses check it under the lock
+	uint32_t status;
+	Klock(&channel->lock, &status);
 	channel->flags &= ~CHANNEL_ALIVE;
+	Kunlock(&channel->lock, &status);
 
 	// At this point all communications that where running will fail
 
@@ -635,14 +735,18 @@ int32_t ker_ChannelDestroy(process_t* process, channel_t* channel)
 			kfree(connection->shared, sizeof(sobj_t));
 		}
 
-		kfree(connection, sizeof(connection_t));
+		// Interrupt pulses can still be going through it
+		RcuFree(connection, sizeof(connection_t));
 
 		count--;
 	}
 
 	// Remove all messages and pulses
 	MsgsFlush(&channel->send);
-	MsgsFlush(&channel->notify);
+	Klock(&channel->lock, &status);
+	// Pulses can still be sent from interrupts
+	NotifyFlush(&channel->notify);
+	Kunlock(&channel->lock, &status);
 	MsgsFlush(&channel->response);
 	MsgsReceiverFlush(&channel->receive);
 	VectorFree(&channel->messages);
@@ -650,7 +754,8 @@ int32_t ker_ChannelDestroy(process_t* process, channel_t* channel)
 	// Remove channel from process
 	VectorRemove(&process->channels, (uint32_t)channel->chid);
 
-	kfree(channel, sizeof(channel_t));
+	// Senders can still be looking it up
+	RcuFree(channel, sizeof(channel_t));
 
 	return E_OK;
 }
@@ -665,10 +770,23 @@ int32_t ChannelDestroy(int32_t chid)
 	// Get running process
 	process_t* process = SchedGetRunningProcess();
 
+	// Another task of the process can be destroying it too
+	RcuReadLock();
+
 	// Get channel
 	channel_t* channel = VectorPeek(&process->channels, (uint32_t)chid);
 
-	return ker_ChannelDestroy(process, channel);
+	if((channel == NULL) || !(channel->flags & CHANNEL_ALIVE))
+	{
+		RcuReadUnlock();
+		return E_INVAL;
+	}
+
+	int32_t ret = ker_ChannelDestroy(process, channel);
+
+	RcuReadUnlock();
+
+	return ret;
 }
 
 /**
@@ -676,6 +794,12 @@ int32_t ChannelDestroy(int32_t chid)
 */
 int32_t ker_ConnectDetach(process_t* process, clink_t* link, bool_t force)
 {
+	// The interrupts references are only dropped when they are detached
+	if((force != TRUE) && (link->refs <= link->pulses))
+	{
+		return E_BUSY;
+	}
+
 	// Only terminate the connection/link if there is no more references to it
 	// or if caller forces the closing
 	if((--link->refs > 0) && (force != TRUE))
@@ -705,7 +829,10 @@ int32_t ker_ConnectDetach(process_t* process, clink_t* link, bool_t force)
 
 	// Remove messages and pulses related to this link from the channel
 	MsgsFlushByScoid(&channel->send, connection->scoid, process);
-	MsgsFlushByScoid(&channel->notify, connection->scoid, process);
+	uint32_t status;
+	Klock(&channel->lock, &status);
+	NotifyFlushByScoid(&channel->notify, connection->scoid);
+	Kunlock(&channel->lock, &status);
 	MsgsFlushByScoid(&channel->response, connection->scoid, process);
 
 	// Save coid to be later used
@@ -739,14 +866,14 @@ int32_t ker_ConnectDetach(process_t* process, clink_t* link, bool_t force)
 		// Free scoid
 		VectorRemove(&channel->connections, (uint32_t)connection->scoid);
 
-		kfree(connection, sizeof(*connection));
+		RcuFree(connection, sizeof(*connection));
 	}
 
 	// At this point it is safe to unlink the connection from the process
 	VectorRemove(&process->connections, (uint32_t)coid);
 
-	// Free allocated memory
-	kfree(link, sizeof(*link));
+	// Free allocated memory, other tasks of the process can be sending through it
+	RcuFree(link, sizeof(*link));
 
 	return E_OK;
 }
@@ -759,16 +886,24 @@ int32_t ConnectDetach(int32_t coid)
 	// Get running process
 	process_t* process = SchedGetRunningProcess();
 
+	// Another task of the process can be detaching it too
+	RcuReadLock();
+
 	// Get connection/link
 	clink_t* link = (clink_t*)VectorPeek(&process->connections, (uint32_t)coid);
 
 	// Check if we got a valid link
 	if(link == NULL)
 	{
+		RcuReadUnlock();
 		return E_INVAL;
 	}
 
-	return ker_ConnectDetach(process, link, FALSE);
+	int32_t ret = ker_ConnectDetach(process, link, FALSE);
+
+	RcuReadUnlock();
+
+	return ret;
 }
 
 /**
@@ -788,12 +923,16 @@ int32_t MsgSend(int32_t coid, const io_hdr_t* hdr, const char* smsg, const char*
 	// Get running task
 	task_t* task = SchedGetRunningTask();
 
+	// Lockless lookup, other tasks can detach the connection or destroy the channel
+	RcuReadLock();
+
 	// Get connection link
 	clink_t* link = VectorPeek(&process->connections, coid);
 
 	// Check if connection link is valid
 	if((link == NULL) || (link->flags & CLINK_DEAD) || link->connection == NULL)
 	{
+		RcuReadUnlock();
 		return E_INVAL;
 	}
 
@@ -802,6 +941,7 @@ int32_t MsgSend(int32_t coid, const io_hdr_t* hdr, const char* smsg, const char*
 
 	if((channel == NULL) || !(channel->flags & CHANNEL_ALIVE))
 	{
+		RcuReadUnlock();
 		return IPC_CHANNEL_DEAD;
 	}
 
@@ -830,6 +970,9 @@ int32_t MsgSend(int32_t coid, const io_hdr_t* hdr, const char* smsg, const char*
     uint32_t status;
     Klock(&channel->lock, &status);
 
+    // Queued on the channel now, its destruction takes care of us
+    RcuReadUnlock();
+
     task_t* receiver = GLISTNODE2TYPE(GlistRemoveFirst(&channel->receive), task_t, node);
 
     if(receiver != NULL)
@@ -897,12 +1040,16 @@ int32_t MsgReceive(int32_t chid, io_hdr_t* hdr, const char* msg, size_t size, ui
 	// Get running task
 	task_t* task = SchedGetRunningTask();
 
+	// The channel can be destroyed by another task, only used till we block
+	RcuReadLock();
+
 	// Get Channel
 	channel_t* channel = (channel_t *)VectorPeek(&process->channels, chid);
 
 	// Check if channel is still alive
 	if((channel == NULL) || !(channel->flags & CHANNEL_ALIVE))
 	{
+		RcuReadUnlock();
 		return IPC_CHANNEL_DEAD;
 	}
 
@@ -917,6 +1064,7 @@ int32_t MsgReceive(int32_t chid, io_hdr_t* hdr, const char* msg, size_t size, ui
     {
     	task->ret = INVALID_RCVID;
         GlistInsertObject(&channel->receive, &task->node);
+        RcuReadUnlock();
         // Suspend receiver
         SchedLock(NULL);
         Kunlock(&channel->lock, NULL);
@@ -939,23 +1087,24 @@ int32_t MsgReceive(int32_t chid, io_hdr_t* hdr, const char* msg, size_t size, ui
     		// TODO: Priority
     		task->active_prio = task->client->active_prio;
     	}
-    	else
+    	else if(task->data.notify.notification != NULL)
     	{
     		// TODO: Priority
     		task->active_prio = ((notify_t*)task->data.notify.notification)->priority;
     	}
     	Kunlock(&channel->lock, &status);
+    	RcuReadUnlock();
     }
 
     if(rcvid == NOTIFY_RCVID)
     {
     	if(task->data.notify.notification == NULL)
     	{
-    		MsgSetResponseHeader(hdr, task->data.notify.type, task->data.notify.data, 0, (size_t)CONNECTION_USCOID(channel->chid, task->data.notify.scoid));
+    		MsgSetResponseHeader(hdr, task->data.notify.type, task->data.notify.data, 0, (size_t)CONNECTION_USCOID(chid, task->data.notify.scoid));
     	}
     	else
     	{
-    		MsgSetResponseHeader(hdr, ((notify_t*)task->data.notify.notification)->type, ((notify_t*)task->data.notify.notification)->data, 0, (size_t)CONNECTION_USCOID(channel->chid, ((notify_t*)task->data.notify.notification)->scoid));
+    		MsgSetResponseHeader(hdr, ((notify_t*)task->data.notify.notification)->type, ((notify_t*)task->data.notify.notification)->data, 0, (size_t)CONNECTION_USCOID(chid, ((notify_t*)task->data.notify.notification)->scoid));
     		// Release memory used to pass the notification
     		kfree(task->data.notify.notification, sizeof(notify_t));
     		task->data.notify.notification = NULL;
@@ -976,10 +1125,10 @@ int32_t MsgReceive(int32_t chid, io_hdr_t* hdr, const char* msg, size_t size, ui
 		// Fill info
 		info->pid = (sender->tid >> 16);
 		info->tid = sender->tid;
-		info->chid = channel->chid;
+		info->chid = chid;
 		info->coid = sender->data.msg.coid;
 		// NOTE: User space scoid is a combination of chid and scoid
-		info->scoid = CONNECTION_USCOID(channel->chid, sender->data.msg.scoid);
+		info->scoid = CONNECTION_USCOID(chid, sender->data.msg.scoid);
 	}
 
 	// Get offset/send size if receiver requests it
@@ -1003,12 +1152,16 @@ int32_t MsgRespond(int32_t rcvid, int32_t status, const char *msg, size_t size)
 	// Get running task
 	task_t* task = SchedGetRunningTask();
 
+	// The channel can be destroyed by another task
+	RcuReadLock();
+
 	// Get Channel
 	channel_t* channel = (channel_t*)VectorPeek(&process->channels, MSGCHID(rcvid));
 
 	// Check if channel is still alive
 	if((channel == NULL) || !(channel->flags & CHANNEL_ALIVE))
 	{
+		RcuReadUnlock();
 		// Channel is dead restore receiver priority
 		task->client = NULL;
 		task->chid = INVALID_CHID;
@@ -1025,6 +1178,7 @@ int32_t MsgRespond(int32_t rcvid, int32_t status, const char *msg, size_t size)
 	if(task->client == NULL)
 	{
 		VectorRemove(&channel->messages, MSGID(rcvid));
+		RcuReadUnlock();
 		task->chid = INVALID_CHID;
 		//TODO: PriorityRestore(task, task->real_prio);
 		task->active_prio = task->real_prio;
@@ -1046,6 +1200,7 @@ int32_t MsgRespond(int32_t rcvid, int32_t status, const char *msg, size_t size)
     GlistRemoveSpecific(&sender->node);
     // Release channel
     Kunlock(&channel->lock, &stat);
+    RcuReadUnlock();
 
     // Detach server task from client task
     task->client = NULL;
@@ -1073,12 +1228,16 @@ int32_t MsgWrite(int32_t rcvid, const void *msg, size_t size, int32_t offset)
 	// Get running task
 	task_t* task = SchedGetRunningTask();
 
+	// The channel can be destroyed by another task
+	RcuReadLock();
+
 	// Get Channel
 	channel_t* channel = (channel_t*)VectorPeek(&process->channels, MSGCHID(rcvid));
 
 	// Check if channel is still alive
 	if((channel == NULL) || !(channel->flags & CHANNEL_ALIVE))
 	{
+		RcuReadUnlock();
 		// Channel is dead restore receiver priority
 		task->client = NULL;
 		task->chid = INVALID_CHID;
@@ -1095,6 +1254,7 @@ int32_t MsgWrite(int32_t rcvid, const void *msg, size_t size, int32_t offset)
 	if(task->client == NULL)
 	{
 		VectorRemove(&channel->messages, MSGID(rcvid));
+		RcuReadUnlock();
 		task->chid = INVALID_CHID;
 		//TODO: PriorityRestore(task, task->real_prio);
 		task->active_prio = task->real_prio;
@@ -1103,6 +1263,8 @@ int32_t MsgWrite(int32_t rcvid, const void *msg, size_t size, int32_t offset)
 		return E_ERROR;
 	}
 
+	RcuReadUnlock();
+
 	// Get message
 	task_t* sender = task->client;
 
@@ -1123,12 +1285,16 @@ int32_t MsgRead(int32_t rcvid, const void *msg, size_t size, int32_t offset)
 	// Get running task
 	task_t* task = SchedGetRunningTask();
 
+	// The channel can be destroyed by another task
+	RcuReadLock();
+
 	// Get Channel
 	channel_t* channel = (channel_t*)VectorPeek(&process->channels, MSGCHID(rcvid));
 
 	// Check if channel is still alive
 	if((channel == NULL) || !(channel->flags & CHANNEL_ALIVE))
 	{
+		RcuReadUnlock();
 		// Channel is dead restore receiver priority
 		task->client = NULL;
 		task->chid = INVALID_CHID;
@@ -1145,6 +1311,7 @@ int32_t MsgRead(int32_t rcvid, const void *msg, size_t size, int32_t offset)
 	if(task->client == NULL)
 	{
 		VectorRemove(&channel->messages, MSGID(rcvid));
+		RcuReadUnlock();
 		task->chid = INVALID_CHID;
 		//TODO: PriorityRestore(task, task->real_prio);
 		task->active_prio = task->real_prio;
@@ -1153,10 +1320,68 @@ int32_t MsgRead(int32_t rcvid, const void *msg, size_t size, int32_t offset)
 		return E_ERROR;
 	}
 
+	RcuReadUnlock();
+
 	// Read message from sender at specified offset
 	return MsgCopyFromSender(task->client, (char*)msg, size, offset);
 }
 
+static int32_t NotifyDeliver(channel_t* channel, notify_t* notify)
+{
+    uint32_t status;
+    Klock(&channel->lock, &status);
+
+    // Destroyed after the caller checked it, the pending pulses were already flushed
+    if(!(channel->flags & CHANNEL_ALIVE))
+    {
+        Kunlock(&channel->lock, &status);
+        if(!(notify->flags & NOTIFY_STATIC))
+        {
+            kfree(notify, sizeof(notify_t));
+        }
+        return E_INVAL;
+    }
+
+    // Still waiting to be received, coalesce with the pending one
+    if(notify->flags & NOTIFY_QUEUED)
+    {
+        Kunlock(&channel->lock, &status);
+        return E_OK;
+    }
+
+    task_t* receiver = GLISTNODE2TYPE(GlistRemoveFirst(&channel->receive), task_t, node);
+
+    if(receiver != NULL)
+    {
+        // Set up receiver task to attend sent message
+        receiver->active_prio = notify->priority;
+        receiver->data.notify.data = notify->data;
+        receiver->data.notify.scoid = notify->scoid;
+        receiver->data.notify.type = notify->type;
+        receiver->data.notify.notification = NULL;
+        receiver->ret = NOTIFY_RCVID;
+        Kunlock(&channel->lock, &status);
+        // For now
+        if(!(notify->flags & NOTIFY_STATIC))
+        {
+            kfree(notify, sizeof(notify_t));
+        }
+        // Unblock receiver
+        SchedAddTask(receiver);
+    }
+    else
+    {
+        // Add notification to notification pending list
+        notify->flags |= NOTIFY_QUEUED;
+    	GlistInsertObject(&channel->notify, &notify->node);
+        // TODO: Resolve priority inversion
+        // ChannelResolvePriority(channel, priority);
+        Kunlock(&channel->lock, &status);
+    }
+
+    return E_OK;
+}
+
 /**
  * ker_MsgNotify Implementation (See header file for description)
 */
@@ -1180,38 +1405,48 @@ int32_t ker_MsgNotify(connection_t* connection, int32_t priority, int32_t type,
 	notify->scoid = connection->scoid;
 	notify->type = type;
 	notify->data = value;
+	notify->flags = 0;
 
-    uint32_t status;
-    Klock(&channel->lock, &status);
+	return NotifyDeliver(channel, notify);
+}
 
-    task_t* receiver = GLISTNODE2TYPE(GlistRemoveFirst(&channel->receive), task_t, node);
+/**
+ * ker_MsgPulse Implementation (See header file for description)
+*/
+int32_t ker_MsgPulse(connection_t* connection, notify_t* notify)
+{
+	if((connection == NULL) || (connection->flags & CONNECTION_INVALID))
+	{
+		return E_INVAL;
+	}
 
-    if(receiver != NULL)
-    {
-        Kunlock(&channel->lock, &status);
-        // Set up receiver task to attend sent message
-        receiver->active_prio = priority;
-        receiver->data.notify.data = value;
-        receiver->data.notify.scoid = connection->scoid;;
-        receiver->data.notify.type = type;
-        receiver->data.notify.notification = NULL;
-        receiver->ret = NOTIFY_RCVID;
-        // For now
-        kfree(notify, sizeof(notify_t));
-        // Unblock receiver
-        SchedAddTask(receiver);
-    }
-    else
-    {
-        // Add notification to notification pending list
-    	GlistInsertObject(&channel->notify, &notify->node);
-        // TODO: Resolve priority inversion
-        // ChannelResolvePriority(channel, priority);
-        // Before release the channel lock get the scheduler lock to safely suspend running task
-        Kunlock(&channel->lock, &status);
-    }
+	notify->scoid = connection->scoid;
 
-	return E_OK;
+	return NotifyDeliver(connection->channel, notify);
+}
+
+/**
+ * ker_MsgPulseCancel Implementation (See header file for description)
+*/
+void ker_MsgPulseCancel(connection_t* connection, notify_t* notify)
+{
+	if(connection == NULL)
+	{
+		return;
+	}
+
+	channel_t* channel = connection->channel;
+
+	uint32_t status;
+	Klock(&channel->lock, &status);
+
+	if(notify->flags & NOTIFY_QUEUED)
+	{
+		GlistRemoveSpecific(&notify->node);
+		notify->flags &= ~NOTIFY_QUEUED;
+	}
+
+	Kunlock(&channel->lock, &status);
 }
 
 /**
@@ -1222,16 +1457,23 @@ int32_t MsgNotify(int32_t coid, int32_t priority, int32_t type, int32_t value)
 	// Get running process
 	process_t* process = SchedGetRunningProcess();
 
+	RcuReadLock();
+
 	// Get connection link
 	clink_t* link = VectorPeek(&process->connections, coid);
 
 	// Check if connection link is still valid
 	if((link == NULL) || (link->flags & CLINK_DEAD) || link->connection == NULL)
 	{
+		RcuReadUnlock();
 		return E_INVAL;
 	}
 
-	return ker_MsgNotify(link->connection, priority, type, value);
+	int32_t ret = ker_MsgNotify(link->connection, priority, type, value);
+
+	RcuReadUnlock();
+
+	return ret;
 }
 
 /**
@@ -1239,8 +1481,11 @@ int32_t MsgNotify(int32_t coid, int32_t priority, int32_t type, int32_t value)
 */
 void IpcSendCancel(task_t* task)
 {
+	// The task can be cancelled while its process detaches the connection
+	RcuReadLock();
+
 	// Get connection link and channel
-	clink_t* link = VectorPeek(&task->parent->connections, task->data.msg.coid);;
+	clink_t* link = VectorPeek(&task->parent->connections, task->data.msg.coid);
 	channel_t* channel = link->connection->channel;
 
 	uint32_t status;
@@ -1249,6 +1494,8 @@ void IpcSendCancel(task_t* task)
 	GlistRemoveSpecific(&task->node);
 
 	Kunlock(&channel->lock, &status);
+
+	RcuReadUnlock();
 }
 
 /**
@@ -1256,6 +1503,7 @@ void IpcSendCancel(task_t* task)
 */
 void IpcReceiveCancel(task_t* task)
 {
+	RcuReadLock();
 	// Get Channel
 	channel_t* channel = (channel_t *)VectorPeek(&task->parent->channels, task->chid);
 	// Lock channel to remove the task from the receiver list
@@ -1265,6 +1513,7 @@ void IpcReceiveCancel(task_t* task)
 	GlistRemoveSpecific(&task->node);
 	// Release channel
 	Kunlock(&channel->lock, &status);
+	RcuReadUnlock();
 }
 
 /**
@@ -1272,8 +1521,10 @@ void IpcReceiveCancel(task_t* task)
 */
 void IpcReplyCancel(task_t* task)
 {
+	RcuReadLock();
+
 	// Get connection link and channel
-	clink_t* link = VectorPeek(&task->parent->connections, task->data.msg.coid);;
+	clink_t* link = VectorPeek(&task->parent->connections, task->data.msg.coid);
 	channel_t* channel = link->connection->channel;
 
 	uint32_t status;
@@ -1283,4 +1534,6 @@ void IpcReplyCancel(task_t* task)
 	GlistRemoveSpecific(&task->node);
 
 	Kunlock(&channel->lock, &status);
+
+	RcuReadUnlock();
 }
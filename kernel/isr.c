@@ -20,11 +20,16 @@
 #include <board.h>
 #include <rfs.h>
 #include <arch.h>
+#include <spinlock.h>
+#include <klock.h>
 
 #include <scheduler.h>
 
 #include <systimer.h>
 
+#include <latency.h>
+#include <rcu.h>
+
 
 /* Private types ------------------------------------------ */
 
@@ -37,6 +42,7 @@
 
 #define INTERRUP_ID(task, irq)		((task->parent->pid << 16) | intr)
 #define INTERRUP_IRQ(id)			(id & 0xFFFF)
+#define INTERRUP_PULSE_ID(process, intr)	((process->pid << 16) | intr)
 
 #define INTRERRUP_AVAILABLE			(0X0)
 #define INTRERRUP_RESERVED			(0xFFFFFFFF)
@@ -49,6 +55,8 @@ struct
 	isr_t		**privQueue;
 	uint32_t	shared;
 	isr_t		**sharedQueue;
+	klock_t		lock;		// Interrupts targets
+	uint32_t	ticks;
 }interruptHandler;;
 
 /* Private function prototypes ---------------------------- */
@@ -134,6 +142,99 @@ int32_t InterruptRegister(isr_t *isr)
 	return E_OK;
 }
 
+static bool_t InterruptIsAttached(isr_t *isr)
+{
+	return ((isr != (isr_t*)(INTRERRUP_AVAILABLE)) && (isr != (isr_t*)(INTRERRUP_RESERVED)));
+}
+
+static void InterruptStatsInit(isr_t *isr)
+{
+	// Private interrupts are banked per cpu, only shared ones can move
+	if(isr->interrupt.irq < interruptHandler.private)
+	{
+		isr->interrupt.affinity = (1UL << isr->interrupt.target);
+	}
+	else
+	{
+		isr->interrupt.affinity = ((1UL << BoardGetCpus()) - 1);
+	}
+
+	isr->interrupt.count = 0;
+	isr->interrupt.sample = 0;
+	isr->interrupt.load = 0;
+}
+
+static void InterruptTargetRemove(isr_t *isr)
+{
+	uint32_t status;
+	Klock(&interruptHandler.lock, &status);
+
+	// Disable the interrupt
+	InterruptDisable(isr->interrupt.irq);
+	InterruptSetTarget(isr->interrupt.irq, isr->interrupt.target, FALSE);
+
+	// Remove handler for the interrupt
+	InterruptRelease(isr->interrupt.irq, isr->interrupt.target);
+
+	Kunlock(&interruptHandler.lock, &status);
+}
+
+static bool_t InterruptIsPulse(isr_t *isr)
+{
+	return (InterruptIsAttached(isr) && (isr->attach.link != NULL));
+}
+
+static isr_t *InterruptPulseGet(int32_t id)
+{
+	process_t *process = SchedGetRunningProcess();
+	int32_t intr = INTERRUP_IRQ(id);
+
+	if((intr >= interruptHandler.shared) || (id != INTERRUP_PULSE_ID(process, intr)))
+	{
+		return NULL;
+	}
+
+	//TODO: we need to know the cpu where the interrupt is assigned
+	isr_t *isr = InterruptGet(intr, RUNNING_CPU);
+
+	if(!InterruptIsPulse(isr) || (isr->attach.id != id))
+	{
+		return NULL;
+	}
+
+	return isr;
+}
+
+static isr_t *InterruptFromId(int32_t intr, int32_t id)
+{
+	task_t *task = SchedGetRunningTask();
+
+	if((task->interrupt.id == id) && (task->interrupt.irq == intr))
+	{
+		//TODO: we need to know the cpu where the interrupt is assigned
+		return InterruptGet(task->interrupt.irq, RUNNING_CPU);
+	}
+
+	isr_t *isr = InterruptPulseGet(id);
+
+	return (((isr != NULL) && (isr->interrupt.irq == intr)) ? isr : NULL);
+}
+
+static void InterruptPulseClean(process_t *process, isr_t *isr)
+{
+	InterruptTargetRemove(isr);
+
+	// The pulse can still be pending in the channel
+	ker_MsgPulseCancel(isr->attach.link->connection, &isr->attach.pulse);
+
+	// Drop the reference taken on attach, closes the link if the process already detached it
+	isr->attach.link->pulses--;
+	ker_ConnectDetach(process, isr->attach.link, FALSE);
+
+	// Another cpu can be handling the interrupt
+	RcuFree(isr, sizeof(*isr));
+}
+
 /* Private functions -------------------------------------- */
 
 int32_t InterruptHandlerInit()
@@ -149,6 +250,10 @@ int32_t InterruptHandlerInit()
 	// TODO: For now we put all as supported (0x0) in future only the supported are set to 0x0 not supported are set to 0x1
 	memset(interruptHandler.sharedQueue, 0x0, interruptHandler.shared  * sizeof(isr_t*));
 
+	KlockInit(&interruptHandler.lock);
+	KlockName(&interruptHandler.lock, "interrupts");
+	interruptHandler.ticks = 0;
+
 	return E_OK;
 }
 
@@ -162,50 +267,64 @@ void UserInterruptHandle(uint32_t irq, uint32_t source)
 		return;
 	}
 
-	if(isr->attach.handler != NULL)
-	{
-		bool_t restore = FALSE; // Change running process and test and them restore it???
+	// Only the cpu handling it touches it, the interrupt is active until its end
+	isr->interrupt.count++;
 
-		// Switch context if necessary
-		if(isr->attach.task != NULL && isr->attach.task->parent != SchedGetRunningProcess())
-		{
-			restore = TRUE;
+#ifdef IRQ_LATENCY
+	LatencyIrqDispatch();
+#endif
 
-			_VirtualSpaceSet(
-				NULL,
-				(pgt_t)MemoryL2P((ptr_t)isr->attach.task->parent->Memory.pgt),
-				isr->attach.task->parent->pid
-			);
-		}
+	if(isr->attach.link != NULL)
+	{
+		// Masked until the receiver unmasks it, at most one pulse is pending
+		InterruptDisable(irq);
+		isr->attach.masked = TRUE;
 
-		// Call Interrupt Dispatcher
-		InterruptDispache(irq, source, isr->attach.handler, (void*)isr->attach.arg);
+		// Detaching the interrupt releases the link and connection through RCU, irqlevel keeps
+		// this cpu from passing a quiescent point until we are done. The channel may be gone,
+		// the pulse is dropped
+		(void)ker_MsgPulse(isr->attach.link->connection, &isr->attach.pulse);
 
-		if(/*restore && */SchedGetRunningProcess() != NULL)
-		{
-			_VirtualSpaceSet(
-				NULL,
-				(pgt_t)MemoryL2P((ptr_t)SchedGetRunningProcess()->Memory.pgt),
-				SchedGetRunningProcess()->pid
-			);
-		}
+		return;
+	}
 
-		// Unlock tasks waiting on this interrupt
-		if((NULL != isr->attach.task) && (isr->attach.pending == TRUE))
-		{
-			isr->attach.pending = FALSE;
-			SchedAddTask(isr->attach.task);
-		}
-		else
+	if(isr->attach.task == NULL)
+	{
+		// Kernel handlers don't need any process translations
+		if(isr->attach.handler != NULL)
 		{
-			// Set interrupt as received
-			isr->attach.set = TRUE;
+			InterruptDispache(irq, source, isr->attach.handler, (void*)isr->attach.arg);
 		}
+
+		return;
+	}
+
+	// Process handlers run in the attached task. Keep the interrupt masked until
+	// the task is done with it so a level interrupt doesn't fire again
+	InterruptDisable(irq);
+	isr->attach.masked = TRUE;
+
+	// Unlock tasks waiting on this interrupt
+	if(isr->attach.pending == TRUE)
+	{
+		isr->attach.pending = FALSE;
+		SchedAddTask(isr->attach.task);
+	}
+	else
+	{
+		// Set interrupt as received
+		isr->attach.set = TRUE;
 	}
 }
 
 void* InterruptHandler(uint32_t irqinfo)
 {
+#ifdef IRQ_LATENCY
+	// Acknowledged right before the handler was called
+	latency_irq_t latency;
+	LatencyIrqEnter(&latency);
+#endif
+
 	uint32_t irq;
 	uint32_t source;
 	InterruptDecode(irqinfo, &irq, &source);
@@ -225,6 +344,10 @@ void* InterruptHandler(uint32_t irqinfo)
     // Signal end of interruption service
     InterruptEnd(irq);
 
+#ifdef IRQ_LATENCY
+    LatencyIrqExit(&latency);
+#endif
+
     //return SchedIrqExit();
     return NULL;
 }
@@ -270,12 +393,15 @@ int32_t InterruptAttach (int32_t intr, uint8_t priority, void *(*handler)(void *
 	isr->interrupt.target = RUNNING_CPU;
 	isr->interrupt.priority = priority;
 	isr->interrupt.enable = TRUE;
+	InterruptStatsInit(isr);
 
 	isr->attach.task = task;
 	isr->attach.arg = area;
 	isr->attach.handler = handler;
 	isr->attach.set = FALSE;
 	isr->attach.pending = FALSE;
+	isr->attach.masked = FALSE;
+	isr->attach.link = NULL;
 
 	InterruptRegister(isr);
 
@@ -293,6 +419,106 @@ int32_t InterruptAttach (int32_t intr, uint8_t priority, void *(*handler)(void *
 	return isr->attach.id;
 }
 
+int32_t InterruptAttachPulse(int32_t intr, uint8_t priority, int32_t coid, int32_t type, int32_t value)
+{
+	process_t *process = SchedGetRunningProcess();
+	task_t *task = SchedGetRunningTask();
+
+	// Held till the reference below keeps the link from being detached
+	RcuReadLock();
+
+	// Get connection link
+	clink_t *link = VectorPeek(&process->connections, coid);
+
+	// Check if connection link is still valid
+	if((link == NULL) || (link->connection == NULL))
+	{
+		RcuReadUnlock();
+		return E_INVAL;
+	}
+
+	int32_t ret = InterruptReserve(intr, RUNNING_CPU);
+
+	if(ret != E_OK)
+	{
+		RcuReadUnlock();
+		return ret;
+	}
+
+	isr_t *isr = (isr_t*)kmalloc(sizeof(isr_t));
+
+	if(NULL == isr)
+	{
+		RcuReadUnlock();
+		InterruptRelease(intr, RUNNING_CPU);
+
+		return E_ERROR;
+	}
+
+	isr->attach.id = INTERRUP_PULSE_ID(process, intr);
+
+	isr->interrupt.irq = intr;
+	isr->interrupt.target = RUNNING_CPU;
+	isr->interrupt.priority = priority;
+	isr->interrupt.enable = TRUE;
+	InterruptStatsInit(isr);
+
+	isr->attach.task = NULL;
+	isr->attach.arg = NULL;
+	isr->attach.handler = NULL;
+	isr->attach.set = FALSE;
+	isr->attach.pending = FALSE;
+	isr->attach.masked = FALSE;
+	isr->attach.link = link;
+
+	// Pulse is sent with the priority of the attaching task
+	isr->attach.pulse.type = type;
+	isr->attach.pulse.data = value;
+	isr->attach.pulse.scoid = link->connection->scoid;
+	isr->attach.pulse.priority = (uint16_t)task->active_prio;
+	isr->attach.pulse.flags = NOTIFY_STATIC;
+
+	// Link can't be closed while the interrupt uses it, ConnectDetach leaves this reference alone
+	link->refs++;
+	link->pulses++;
+
+	RcuReadUnlock();
+
+	InterruptRegister(isr);
+
+	InterruptSetTarget(isr->interrupt.irq, isr->interrupt.target, TRUE);
+	InterruptSetPriority(isr->interrupt.irq, (uint32_t)isr->interrupt.priority);
+	InterruptEnable(isr->interrupt.irq);
+
+	return isr->attach.id;
+}
+
+void InterruptProcessClean(process_t *process)
+{
+	uint32_t cpus = BoardGetCpus();
+	uint32_t i;
+
+	for(i = 0; i < (interruptHandler.private * cpus); i++)
+	{
+		isr_t *isr = interruptHandler.privQueue[i];
+
+		if(InterruptIsPulse(isr) && ((isr->attach.id >> 16) == process->pid))
+		{
+			InterruptPulseClean(process, isr);
+		}
+	}
+
+	for(i = 0; i < (interruptHandler.shared - interruptHandler.private); i++)
+	{
+		isr_t *isr = interruptHandler.sharedQueue[i];
+
+		if(InterruptIsPulse(isr) && ((isr->attach.id >> 16) == process->pid))
+		{
+			InterruptPulseClean(process, isr);
+		}
+	}
+}
+
 int32_t InterruptClean(task_t *task)
 {
 	if(task->interrupt.id == INTERRUPT_INVALID)
@@ -303,19 +529,14 @@ int32_t InterruptClean(task_t *task)
 	//TODO: we need to know the cpu where the interrupt is assigned
 	isr_t* isr = InterruptGet(task->interrupt.irq, RUNNING_CPU);
 
-	// Disable the interrupt
-	InterruptDisable(isr->interrupt.irq);
-	InterruptSetTarget(isr->interrupt.irq, isr->interrupt.target, FALSE);
-
-	// Remove handler for the interrupt
-	InterruptRelease(isr->interrupt.irq, isr->interrupt.target);
+	InterruptTargetRemove(isr);
 
 	// Clean task interrupt data
 	task->interrupt.id  = INTERRUPT_INVALID;
 	task->interrupt.irq = INTERRUPT_INVALID;
 
-	// Clean interrupt structure
-	kfree(isr, sizeof(*isr));
+	// Clean interrupt structure, another cpu can be handling the interrupt
+	RcuFree(isr, sizeof(*isr));
 
 	return E_OK;
 
@@ -327,7 +548,16 @@ int32_t InterrupDetach(int32_t id)
 
 	if(task->interrupt.id != id)
 	{
-		return E_INVAL;
+		isr_t *isr = InterruptPulseGet(id);
+
+		if(isr == NULL)
+		{
+			return E_INVAL;
+		}
+
+		InterruptPulseClean(SchedGetRunningProcess(), isr);
+
+		return E_OK;
 	}
 
 	return InterruptClean(task);
@@ -335,17 +565,14 @@ int32_t InterrupDetach(int32_t id)
 
 int32_t InterruptMask( int32_t intr, int32_t id )
 {
-	task_t *task = SchedGetRunningTask();
+	isr_t *isr = InterruptFromId(intr, id);
 
-	if((task->interrupt.id != id) || (task->interrupt.irq != intr))
+	if(isr == NULL)
 	{
 		return E_INVAL;
 	}
 
-	InterruptDisable(task->interrupt.irq);
-
-	//TODO: we need to know the cpu where the interrupt is assigned
-	isr_t *isr = InterruptGet(task->interrupt.irq, RUNNING_CPU);
+	InterruptDisable(isr->interrupt.irq);
 
 	isr->interrupt.enable = FALSE;
 	isr->attach.set = FALSE;
@@ -357,22 +584,135 @@ int32_t InterruptMask( int32_t intr, int32_t id )
 int32_t InterruptUnmask( int32_t intr, int32_t id )
 
 {
-	task_t *task = SchedGetRunningTask();
+	isr_t *isr = InterruptFromId(intr, id);
 
-	if((task->interrupt.id != id) || (task->interrupt.irq != intr))
+	if(isr == NULL)
 	{
 		return E_INVAL;
 	}
 
-	//TODO: we need to know the cpu where the interrupt is assigned
-	isr_t *isr = InterruptGet(task->interrupt.irq, RUNNING_CPU);
-
 	isr->interrupt.enable = TRUE;
+	isr->attach.masked = FALSE;
+
+	InterruptEnable(isr->interrupt.irq);
+
+	return E_OK;
+
+}
+
+int32_t InterruptAffinity(int32_t intr, int32_t id, uint32_t mask)
+{
+	// Private interrupts can't be forwarded to other cpus
+	if((intr < interruptHandler.private) || (intr >= interruptHandler.shared))
+	{
+		return E_INVAL;
+	}
+
+	mask &= ((1UL << BoardGetCpus()) - 1);
+
+	if(mask == 0)
+	{
+		return E_INVAL;
+	}
+
+	isr_t *isr = InterruptFromId(intr, id);
+
+	if(isr == NULL)
+	{
+		return E_INVAL;
+	}
+
+	uint32_t status;
+	Klock(&interruptHandler.lock, &status);
 
-	InterruptEnable(task->interrupt.irq);
+	isr->interrupt.affinity = mask;
+
+	// Move it only if the current target isn't allowed anymore
+	if(!(mask & (1UL << isr->interrupt.target)))
+	{
+		isr->interrupt.target = (uint16_t)__builtin_ctz(mask);
+		InterruptSetTargets(isr->interrupt.irq, (1UL << isr->interrupt.target));
+	}
+
+	Kunlock(&interruptHandler.lock, &status);
 
 	return E_OK;
+}
+
+void InterruptBalance(void)
+{
+	if(++interruptHandler.ticks < INTERRUPT_BALANCE_PERIOD)
+	{
+		return;
+	}
+
+	interruptHandler.ticks = 0;
 
+	uint32_t load[MAX_CPUS] = {0};
+	uint32_t cpus = BoardGetCpus();
+	uint32_t count = (interruptHandler.shared - interruptHandler.private);
+	uint32_t i;
+
+	uint32_t status;
+	Klock(&interruptHandler.lock, &status);
+
+	// Interrupts received by each shared interrupt in the last period
+	for(i = 0; i < count; i++)
+	{
+		isr_t *isr = interruptHandler.sharedQueue[i];
+
+		if(InterruptIsAttached(isr))
+		{
+			uint32_t received = isr->interrupt.count;
+			isr->interrupt.load = (received - isr->interrupt.sample);
+			isr->interrupt.sample = received;
+		}
+	}
+
+	// Busiest first, each one goes to the least loaded cpu it is allowed to run.
+	// Ties keep the current target so a balanced system doesn't move interrupts
+	while(TRUE)
+	{
+		isr_t *busiest = NULL;
+
+		for(i = 0; i < count; i++)
+		{
+			isr_t *isr = interruptHandler.sharedQueue[i];
+
+			if(InterruptIsAttached(isr) && (isr->interrupt.load > 0) &&
+			   ((busiest == NULL) || (isr->interrupt.load > busiest->interrupt.load)))
+			{
+				busiest = isr;
+			}
+		}
+
+		if(busiest == NULL)
+		{
+			break;
+		}
+
+		uint32_t target = busiest->interrupt.target;
+		uint32_t cpu;
+
+		for(cpu = 0; cpu < cpus; cpu++)
+		{
+			if((busiest->interrupt.affinity & (1UL << cpu)) && (load[cpu] < load[target]))
+			{
+				target = cpu;
+			}
+		}
+
+		load[target] += busiest->interrupt.load;
+		busiest->interrupt.load = 0;
+
+		if(target != busiest->interrupt.target)
+		{
+			busiest->interrupt.target = (uint16_t)target;
+			InterruptSetTargets(busiest->interrupt.irq, (1UL << target));
+		}
+	}
+
+	Kunlock(&interruptHandler.lock, &status);
 }
 
 int32_t InterruptWait(int32_t id)
@@ -392,13 +732,26 @@ int32_t InterruptWait(int32_t id)
 		return E_FAULT;
 	}
 
+	uint32_t status;
+	critical_lock(&status);
+
+	// The previous interrupt was handled, let it fire again
+	if(isr->attach.masked == TRUE)
+	{
+		isr->attach.masked = FALSE;
+		InterruptEnable(isr->interrupt.irq);
+	}
+
 	if(isr->attach.set == TRUE)
 	{
 		isr->attach.set = FALSE;
+		critical_unlock(&status);
 		return E_OK;
 	}
 
 	isr->attach.pending = TRUE;
+	critical_unlock(&status);
+
 	SchedStopRunningTask(BLOCKED, INTERRUPT_PENDING);
 
 	return E_OK;
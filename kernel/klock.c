@@ -11,26 +11,157 @@
 #include <arch.h>
 #include <spinlock.h>
 #include <atomic.h>
+#include <asm.h>
+
+#ifdef KLOCK_TORTURE
+#include <board.h>
+#endif
+
+#if defined(KLOCK_TORTURE) || defined(KLOCK_STATS)
+#include <pmu.h>
+#endif
+
+#ifdef KLOCK_STATS
+#include <string.h>
+#endif
 
 
 /* Private types ------------------------------------------ */
 
+#ifdef KLOCK_STATS
+typedef struct klock_class
+{
+    const char* name;
+    // Each cpu accounts what it does while holding the lock or with interrupts disabled
+    struct
+    {
+        uint32_t acquired;
+        uint32_t contended;
+        uint32_t spinMax;
+        uint32_t holdMax;
+        uint64_t spinTotal;
+    }cpu[MAX_CPUS];
+}klockClass_t;
+#endif
 
 
 /* Private constants -------------------------------------- */
 #define KLOCK_FREE				(uint32_t)(-1)
 
+#define KLOCK_TICKET_NEXT		(1UL << 16)
+
+#ifdef KLOCK_STATS
+#define KLOCK_CLASSES           (32)
+#define KLOCK_CLASS_UNNAMED     (0)
+#define KLOCK_CLASS_SPINLOCK    (1)
+#endif
+
+#ifdef KLOCK_TORTURE
+#ifndef KLOCK_TORTURE_ROUNDS
+#define KLOCK_TORTURE_ROUNDS	(100000)
+#endif
+#endif
+
 
 /* Private macros ----------------------------------------- */
 #define RUNNING_CPU				_cpuId()
 
+// Only the owner writes the ticket being served, little endian lower half
+#define KLOCK_SERVING(lock)		(*(volatile uint16_t*)&(lock)->ticket)
+
 
 /* Private variables -------------------------------------- */
 
+#ifdef KLOCK_STATS
+static struct
+{
+    klock_t         lock;       // Not profiled itself
+    uint32_t        count;
+    klockClass_t    classes[KLOCK_CLASSES];
+}registry = {{0, KLOCK_FREE, 0, NULL, 0}, 2, {{"unnamed"}, {"spinlock"}}};
+#endif
 
 
 /* Private function prototypes ---------------------------- */
 
+#ifdef KLOCK_STATS
+static void KlockStatsRecord(klockClass_t* stats, bool_t contended, uint32_t spin)
+{
+    uint32_t cpu = RUNNING_CPU;
+
+    stats->cpu[cpu].acquired++;
+
+    if(contended == TRUE)
+    {
+        stats->cpu[cpu].contended++;
+        stats->cpu[cpu].spinTotal += spin;
+
+        if(spin > stats->cpu[cpu].spinMax)
+        {
+            stats->cpu[cpu].spinMax = spin;
+        }
+    }
+}
+#endif
+
+/*
+ * Take a ticket and wait for it to be served. Waiters only read the lock while
+ * waiting and get it in the order they arrived
+ */
+static void KlockAcquire(klock_t* lock, uint32_t cpu)
+{
+    uint16_t ticket = (uint16_t)(((uint32_t)atomic_add((int32_t*)&lock->ticket, KLOCK_TICKET_NEXT) >> 16) - 1);
+
+#ifdef KLOCK_STATS
+    uint32_t start = PmuCyclesRead();
+    bool_t contended = (KLOCK_SERVING(lock) != ticket) ? TRUE : FALSE;
+#endif
+
+    while(KLOCK_SERVING(lock) != ticket)
+    {
+        _cpu_hold();
+    }
+
+    // Nothing in the critical section can be seen before the lock is ours
+    dmb();
+
+    lock->owner = cpu;
+
+#ifdef KLOCK_STATS
+    lock->since = PmuCyclesRead();
+
+    if(lock->stats != NULL)
+    {
+        KlockStatsRecord(lock->stats, contended, lock->since - start);
+    }
+#endif
+}
+
+static void KlockRelease(klock_t* lock)
+{
+#ifdef KLOCK_STATS
+    if(lock->stats != NULL)
+    {
+        uint32_t hold = PmuCyclesRead() - lock->since;
+        uint32_t cpu = RUNNING_CPU;
+
+        if(hold > lock->stats->cpu[cpu].holdMax)
+        {
+            lock->stats->cpu[cpu].holdMax = hold;
+        }
+    }
+#endif
+
+    lock->owner = KLOCK_FREE;
+
+    // Critical section done before the next ticket is served
+    dmb();
+
+    KLOCK_SERVING(lock)++;
+
+    // Signal cpus in case they are waiting on this lock
+    _cpus_signal();
+}
 
 
 /* Private functions -------------------------------------- */
@@ -42,6 +173,11 @@ void KlockInit(klock_t* lock)
 {
     lock->count = 0;
     lock->owner = KLOCK_FREE;
+    lock->ticket = 0;
+#ifdef KLOCK_STATS
+    lock->stats = &registry.classes[KLOCK_CLASS_UNNAMED];
+    lock->since = 0;
+#endif
 }
 
 /**
@@ -62,10 +198,7 @@ void Klock(klock_t* lock, uint32_t* status)
 
     if(lock->owner != cpu)
     {
-        while(atomic_cmp_set(&lock->owner, KLOCK_FREE, cpu) != E_OK)
-        {
-            _cpu_hold();
-        }
+        KlockAcquire(lock, cpu);
     }
 
     lock->count++;
@@ -85,9 +218,7 @@ void Kunlock(klock_t* lock, uint32_t* status)
 
     if(--lock->count == 0)
     {
-        while(atomic_cmp_set(&lock->owner, cpu, KLOCK_FREE) != E_OK);
-        // Signal cpus in case they are waiting on this lock
-        _cpus_signal();
+        KlockRelease(lock);
     }
 
     if(status)
@@ -117,11 +248,240 @@ void KlockEnsure(klock_t* lock, uint32_t* status)
         return;
     }
 
-    while(atomic_cmp_set(&lock->owner, KLOCK_FREE, cpu) != E_OK)
+    KlockAcquire(lock, cpu);
+
+    lock->count++;
+}
+
+
+#ifdef KLOCK_STATS
+
+/**
+ * KlockName Implementation (See header file for description)
+*/
+void KlockName(klock_t* lock, const char* name)
+{
+    uint32_t status;
+    uint32_t i;
+
+    Klock(&registry.lock, &status);
+
+    for(i = 0; i < registry.count; i++)
+    {
+        if(strcmp(registry.classes[i].name, name) == 0)
+        {
+            break;
+        }
+    }
+
+    // When full the lock stays accounted as unnamed
+    if((i == registry.count) && (registry.count < KLOCK_CLASSES))
     {
-        _cpu_hold();
+        memset(&registry.classes[i], 0x0, sizeof(klockClass_t));
+        registry.classes[i].name = name;
+        registry.count++;
     }
 
-    lock->count++;
+    if(i < registry.count)
+    {
+        lock->stats = &registry.classes[i];
+    }
+
+    Kunlock(&registry.lock, &status);
+}
+
+/**
+ * KlockStatsRead Implementation (See header file for description)
+*/
+int32_t KlockStatsRead(char* buffer, size_t size, uint32_t* offset)
+{
+    if((buffer == NULL) || (size < sizeof(klock_report_t)))
+    {
+        return E_INVAL;
+    }
+
+    klock_report_t* report = (klock_report_t*)buffer;
+    uint32_t count = registry.count;
+    uint32_t i, cpu;
+
+    if(count > (size / sizeof(klock_report_t)))
+    {
+        count = (size / sizeof(klock_report_t));
+    }
+
+    memset(report, 0x0, count * sizeof(klock_report_t));
+
+    // The cpus keep updating their counters, it's a snapshot
+    for(i = 0; i < count; i++)
+    {
+        klockClass_t* stats = &registry.classes[i];
+
+        uint32_t len = strlen(stats->name);
+        memcpy(report[i].name, stats->name, (len < sizeof(report[i].name)) ? (len) : (sizeof(report[i].name) - 1));
+
+        for(cpu = 0; cpu < MAX_CPUS; cpu++)
+        {
+            report[i].acquired += stats->cpu[cpu].acquired;
+            report[i].contended += stats->cpu[cpu].contended;
+            report[i].spinTotal += stats->cpu[cpu].spinTotal;
+
+            if(stats->cpu[cpu].spinMax > report[i].spinMax)
+            {
+                report[i].spinMax = stats->cpu[cpu].spinMax;
+            }
+
+            if(stats->cpu[cpu].holdMax > report[i].holdMax)
+            {
+                report[i].holdMax = stats->cpu[cpu].holdMax;
+            }
+        }
+    }
+
+    if(offset != NULL)
+    {
+        *offset = count * sizeof(klock_report_t);
+    }
+
+    return E_OK;
+}
+
+/*
+ * Spin locks don't have room for a name, they are all accounted as "spinlock"
+ */
+void spinlock(spinlock_t* lock)
+{
+    uint32_t start = PmuCyclesRead();
+    bool_t contended = (*(volatile spinlock_t*)lock != 0) ? TRUE : FALSE;
+
+    spinlock_raw(lock);
+
+    uint32_t spin = PmuCyclesRead() - start;
+
+    // Can be taken with interrupts enabled, keep this cpu counters consistent
+    uint32_t status;
+    critical_lock(&status);
+    KlockStatsRecord(&registry.classes[KLOCK_CLASS_SPINLOCK], contended, spin);
+    critical_unlock(&status);
+}
+
+void spinunlock(spinlock_t* lock)
+{
+    spinunlock_raw(lock);
+}
+
+void spinlock_irq(spinlock_t* lock, uint32_t* state)
+{
+    spinlock(lock);
+    critical_lock(state);
+}
+
+void spinunlock_irq(spinlock_t* lock, uint32_t* state)
+{
+    spinunlock_raw(lock);
+    critical_unlock(state);
+}
+
+#else
+
+/**
+ * KlockStatsRead Implementation (See header file for description)
+*/
+int32_t KlockStatsRead(char* buffer, size_t size, uint32_t* offset)
+{
+    (void)buffer; (void)size;
+
+    // Kernel built without KLOCK_STATS
+    if(offset != NULL)
+    {
+        *offset = 0;
+    }
+
+    return E_INVAL;
+}
+
+#endif /* KLOCK_STATS */
+
+#ifdef KLOCK_TORTURE
+
+static struct
+{
+    klock_t             lock;
+    volatile uint32_t   arrived;
+    volatile uint32_t   done;
+    volatile uint32_t   rounds;
+    uint32_t            acquired[MAX_CPUS];
+    uint32_t            cycles[MAX_CPUS];
+}torture = {{0, KLOCK_FREE, 0}, 0, 0, 0, {0}, {0}};
+
+/**
+ * KlockTorture Implementation (See header file for description)
+*/
+void KlockTorture(klock_torture_t* result)
+{
+    uint32_t cpus = BoardGetCpus();
+    uint32_t cpu = RUNNING_CPU;
+    uint32_t acquired = 0;
+    uint32_t status;
+    uint32_t i;
+
+    // Cycle counter is only enabled when the scheduler starts
+    PmuInit();
+
+    // Start all together so the lock is contended from the first round
+    (void)atomic_inc((int32_t*)&torture.arrived);
+
+    while(torture.arrived < cpus);
+
+    uint32_t start = PmuCyclesRead();
+
+    while(TRUE)
+    {
+        Klock(&torture.lock, &status);
+
+        if(torture.rounds >= KLOCK_TORTURE_ROUNDS)
+        {
+            Kunlock(&torture.lock, &status);
+            break;
+        }
+
+        torture.rounds++;
+        acquired++;
+
+        Kunlock(&torture.lock, &status);
+
+        // Some work outside the lock so a cpu can't just take it back right away
+        for(i = 0; i < 32; i++)
+        {
+            asm volatile("nop");
+        }
+    }
+
+    torture.cycles[cpu] = PmuCyclesRead() - start;
+    torture.acquired[cpu] = acquired;
+    dmb();
+
+    (void)atomic_inc((int32_t*)&torture.done);
+
+    if(result == NULL)
+    {
+        return;
+    }
+
+    while(torture.done < cpus);
+
+    result->cpus = cpus;
+    result->total = torture.rounds;
+    result->cycles = 0;
+
+    for(i = 0; i < MAX_CPUS; i++)
+    {
+        result->acquired[i] = torture.acquired[i];
+
+        if(torture.cycles[i] > result->cycles)
+        {
+            result->cycles = torture.cycles[i];
+        }
+    }
 }
 
+#endif /* KLOCK_TORTURE */
@@ -0,0 +1,247 @@
+/**
+ * @file        latency.c
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        18 October, 2026
+ * @brief       Interrupt Latency Instrumentation implementation
+*/
+
+/* Includes ----------------------------------------------- */
+#include <latency.h>
+#include <arch.h>
+#include <systimer.h>
+#include <string.h>
+
+
+#ifdef IRQ_LATENCY
+
+/* Private types ------------------------------------------ */
+
+
+
+/* Private constants -------------------------------------- */
+
+
+
+/* Private macros ----------------------------------------- */
+
+// Interrupts disabled without going through critical_lock, it would measure itself
+#define irq_save(state)			asm volatile("mrs %0, cpsr\n\tcpsid i" : "=r" (state) : : "memory")
+#define irq_restore(state)		asm volatile("msr cpsr_c, %0" : : "r" (state) : "memory")
+
+
+/* Private variables -------------------------------------- */
+
+static struct
+{
+	latency_hist_t	hist[LATENCY_HISTOGRAMS];
+	latency_irq_t	*irq;		// Interrupt being handled
+	uint32_t		irqoff;		// Interrupts disabled since, 0 when enabled
+}latency[MAX_CPUS];
+
+
+/* Private function prototypes ---------------------------- */
+
+static inline uint32_t LatencyStamp()
+{
+	uint32_t now = (uint32_t)SystemCounterRead();
+
+	// Zero means no timestamp
+	return ((now != 0) ? (now) : (1));
+}
+
+static void LatencyRecord(uint32_t hist, uint32_t ticks)
+{
+	latency_hist_t *h = &latency[RUNNING_CPU].hist[hist];
+
+	h->count++;
+	h->buckets[(ticks != 0) ? (31 - __builtin_clz(ticks)) : (0)]++;
+
+	if(ticks > h->max)
+	{
+		h->max = ticks;
+	}
+}
+
+
+/* Private functions -------------------------------------- */
+
+/**
+ * LatencyIrqEnter Implementation (See header file for description)
+*/
+void LatencyIrqEnter(latency_irq_t *irq)
+{
+	irq->ack = LatencyStamp();
+	irq->dispatch = 0;
+
+	uint32_t state;
+	irq_save(state);
+
+	irq->outer = latency[RUNNING_CPU].irq;
+	latency[RUNNING_CPU].irq = irq;
+
+	irq_restore(state);
+}
+
+/**
+ * LatencyIrqDispatch Implementation (See header file for description)
+*/
+void LatencyIrqDispatch(void)
+{
+	uint32_t state;
+	irq_save(state);
+
+	latency_irq_t *irq = latency[RUNNING_CPU].irq;
+
+	if((irq != NULL) && (irq->dispatch == 0))
+	{
+		irq->dispatch = LatencyStamp();
+		LatencyRecord(LATENCY_ACK_DISPATCH, irq->dispatch - irq->ack);
+	}
+
+	irq_restore(state);
+}
+
+/**
+ * LatencyIrqExit Implementation (See header file for description)
+*/
+void LatencyIrqExit(latency_irq_t *irq)
+{
+	uint32_t state;
+	irq_save(state);
+
+	latency[RUNNING_CPU].irq = irq->outer;
+
+	irq_restore(state);
+}
+
+/**
+ * LatencyTaskWakeup Implementation (See header file for description)
+*/
+void LatencyTaskWakeup(task_t *task)
+{
+	uint32_t state;
+	irq_save(state);
+
+	latency_irq_t *irq = latency[RUNNING_CPU].irq;
+
+	if((irq != NULL) && (irq->dispatch != 0))
+	{
+		task->wakeup = LatencyStamp();
+		LatencyRecord(LATENCY_DISPATCH_WAKEUP, task->wakeup - irq->dispatch);
+	}
+	else
+	{
+		// Not woken up by an interrupt
+		task->wakeup = 0;
+	}
+
+	irq_restore(state);
+}
+
+/**
+ * LatencyTaskRun Implementation (See header file for description)
+*/
+void LatencyTaskRun(task_t *task)
+{
+	if((task == NULL) || (task->wakeup == 0))
+	{
+		return;
+	}
+
+	uint32_t state;
+	irq_save(state);
+
+	// The counter is shared, the task can run on another cpu than the one that woke it
+	LatencyRecord(LATENCY_WAKEUP_RUN, LatencyStamp() - task->wakeup);
+	task->wakeup = 0;
+
+	irq_restore(state);
+}
+
+/**
+ * LatencyIrqOff Implementation (See header file for description)
+*/
+void LatencyIrqOff(void)
+{
+	latency[RUNNING_CPU].irqoff = LatencyStamp();
+}
+
+/**
+ * LatencyIrqOn Implementation (See header file for description)
+*/
+void LatencyIrqOn(void)
+{
+	uint32_t cpu = RUNNING_CPU;
+
+	if(latency[cpu].irqoff != 0)
+	{
+		LatencyRecord(LATENCY_IRQ_OFF, LatencyStamp() - latency[cpu].irqoff);
+		latency[cpu].irqoff = 0;
+	}
+}
+
+/**
+ * LatencyRead Implementation (See header file for description)
+*/
+int32_t LatencyRead(char *buffer, size_t size, uint32_t *offset)
+{
+	if((buffer == NULL) || (size < sizeof(latency_info_t)))
+	{
+		return E_INVAL;
+	}
+
+	latency_info_t *info = (latency_info_t*)buffer;
+	uint32_t cpu, hist, bucket;
+
+	memset(info, 0x0, sizeof(latency_info_t));
+	info->freq = SystemCounterFreq();
+
+	// The cpus keep updating their histograms, counts can be off by the samples in flight
+	for(cpu = 0; cpu < MAX_CPUS; cpu++)
+	{
+		for(hist = 0; hist < LATENCY_HISTOGRAMS; hist++)
+		{
+			latency_hist_t *h = &latency[cpu].hist[hist];
+
+			info->hist[hist].count += h->count;
+
+			if(h->max > info->hist[hist].max)
+			{
+				info->hist[hist].max = h->max;
+			}
+
+			for(bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+			{
+				info->hist[hist].buckets[bucket] += h->buckets[bucket];
+			}
+		}
+	}
+
+	if(offset != NULL)
+	{
+		*offset = sizeof(latency_info_t);
+	}
+
+	return E_OK;
+}
+
+#else
+
+/**
+ * LatencyRead Implementation (See header file for description)
+*/
+int32_t LatencyRead(char *buffer, size_t size, uint32_t *offset)
+{
+	(void)buffer; (void)size;
+
+	// Kernel built without IRQ_LATENCY
+	if(offset != NULL)
+	{
+		*offset = 0;
+	}
+
+	return E_INVAL;
+}
+
+#endif /* IRQ_LATENCY */
@@ -12,8 +12,14 @@
 #include <elf.h>
 #include <kvspace.h>
 #include <memmgr.h>
+#include <frame.h>
 #include <kheap.h>
 #include <string.h>
+#include <misc.h>
+#include <mmu.h>
+#include <rfs.h>
+#include <process.h>
+#include <scheduler.h>
 
 
 /* Private types ------------------------------------------ */
@@ -116,6 +122,48 @@ static int32_t LoadMemory(int8_t *data, size_t fileSize, size_t totalSize, glist
  */
 static int32_t LoadSegment(segment_t *segment, glist_t *memory);
 
+/*
+ * @brief   Routine to use a segment straight from the RFS memory. Only
+ * 			possible when both the segment data and its virtual address
+ * 			are page aligned and it has no zero filled part
+ *
+ * @param   segment -	segment to be mapped
+ * 			memory -	memory list to store the RFS memory object
+ *
+ * @retval  E_OK if the segment can be executed in place
+ */
+static int32_t LoadInPlace(segment_t *segment, glist_t *memory);
+
+/*
+ * @brief   Routine to release the text memory of an image
+ *
+ * @param   info -	image info
+ *
+ * @retval  No return
+ */
+static void LoaderFreeText(loadInf_t *info);
+
+/*
+ * @brief   Routine to load the pristine image of the writable segment. Only
+ * 			the pages backed by the file are allocated, the remaining ones
+ * 			are zero filled by each process on first access
+ *
+ * @param   segment -	writable segment
+ * 			info -		image info to be filled
+ *
+ * @retval  Return Success
+ */
+static int32_t LoadImage(segment_t *segment, loadInf_t *info);
+
+/*
+ * @brief   Routine to free the pristine image of the writable segment
+ *
+ * @param   info -	image info
+ *
+ * @retval  No return
+ */
+static void LoaderFreeImage(loadInf_t *info);
+
 /*
  * @brief   Routine to check if the elf is already loaded
  *
@@ -266,8 +314,18 @@ int32_t LoaderLoadElf(void *raw, char *cmd, exec_t *exec)
 
 		// Initialize text.memory list as FIFO (always insert on the tail and get from head)
 		(void)GlistInitialize(&img->info.text.memory, GFifo);
-		if(LoadSegment(&segment, &img->info.text.memory) != E_OK)
+		// Text sitting page aligned in the RFS is executed in place, otherwise it is copied
+		img->info.text.xip = (LoadInPlace(&segment, &img->info.text.memory) == E_OK);
+		if((img->info.text.xip == FALSE) && (LoadSegment(&segment, &img->info.text.memory) != E_OK))
+		{
+			kfree(img, sizeof(*img));
+			return E_INVAL;
+		}
+
+		// Second segment is .data + .bss, keep its pristine image with the text
+		if((ElfGetNextSegment(&elf, &segment) == E_OK) && (LoadImage(&segment, &img->info) != E_OK))
 		{
+			LoaderFreeText(&img->info);
 			kfree(img, sizeof(*img));
 			return E_INVAL;
 		}
@@ -277,33 +335,28 @@ int32_t LoaderLoadElf(void *raw, char *cmd, exec_t *exec)
 
 		(void)GlistInsertObject(&loaderHandler.imgs, &img->node);
 	}
-	else
-	{
-		// Segment structure has to be initialize with zeros
-		memset(&segment, 0x0, sizeof(segment));
-		// Skip text segment
-		if(ElfGetNextSegment(&elf, &segment) != E_OK)
-		{
-			return E_INVAL;
-		}
-	}
 
-	// Initialize dataMemory list as FIFO (always insert on the tail and get from head)
-	(void)GlistInitialize(&exec->private.dataMemory, GFifo);
-	if(ElfGetNextSegment(&elf, &segment) == E_OK)
+	// Process private pages are only allocated when written
+	exec->private.pages = NULL;
+	if(img->info.image.pages > 0)
 	{
-		if(LoadSegment(&segment, &exec->private.dataMemory) != E_OK)
+		exec->private.pages = (paddr_t*)kmalloc(img->info.image.pages * sizeof(paddr_t));
+
+		if(exec->private.pages == NULL)
 		{
 			exec->load = NULL;
 			if(img->refs == 0)
 			{
 				GlistRemoveSpecific(&img->node);
-				LoaderFreeMemory(&img->info.text.memory);
+				LoaderFreeText(&img->info);
+				LoaderFreeImage(&img->info);
 				kfree(img, sizeof(*img));
 			}
 
-			return E_INVAL;
+			return E_NO_RES;
 		}
+
+		memset(exec->private.pages, 0x0, img->info.image.pages * sizeof(paddr_t));
 	}
 
 	exec->load = &img->info;
@@ -323,14 +376,39 @@ int32_t LoaderUnloadElf(exec_t *exec)
 
 	img->refs -= 1;
 
+	// Drop the process mappings of the shared text
+	mmobj_t *obj = GLISTNODE2TYPE(GlistGetObject(&img->info.text.memory, NULL), mmobj_t, node);
+	for(; obj != NULL; obj = GLIST_NEXT(&obj->node, mmobj_t, node))
+	{
+		FrameUnmap(obj->addr, obj->size);
+	}
+
 	// Unload process private memory
-	LoaderFreeMemory(&exec->private.dataMemory);
+	if(exec->private.pages != NULL)
+	{
+		uint32_t page;
+		for(page = 0; page < exec->load->image.pages; page++)
+		{
+			if(exec->private.pages[page] != NULL)
+			{
+				MemoryFree(exec->private.pages[page], PAGE_SIZE);
+			}
+			else if(page < exec->load->image.filePages)
+			{
+				FrameUnmap(exec->load->image.pristine[page], PAGE_SIZE);
+			}
+		}
+
+		kfree(exec->private.pages, exec->load->image.pages * sizeof(paddr_t));
+		exec->private.pages = NULL;
+	}
 
 	// If there are no more references delete the elf image
 	if(img->refs == 0)
 	{
 		GlistRemoveSpecific(&img->node);
-		LoaderFreeMemory(&img->info.text.memory);
+		LoaderFreeText(&img->info);
+		LoaderFreeImage(&img->info);
 		kfree(img, sizeof(*img) + img->cmdLen);
 	}
 
@@ -394,6 +472,7 @@ int32_t LoadMemory(int8_t *data, size_t fileSize, size_t totalSize, glist_t *mem
 		// 7) Update data pointer
 		data = (int8_t *)((uint32_t)(data) + PAGE_SIZE);
 		// 8) Insert page in the memory list (always insert on the list tail)
+		FrameSetOwner(obj->addr, obj->size, FRAME_SHARED, 0);
 		(void)GlistInsertObject(memory, &obj->node);
 		// 9) Update loaded memory
 		loaded += PAGE_SIZE;
@@ -415,6 +494,7 @@ int32_t LoadMemory(int8_t *data, size_t fileSize, size_t totalSize, glist_t *mem
 		// 4) Unmap page
 		VirtualSpaceUnmmap(vaddr);
 		// 5) Insert page in the memory list (always insert on the list tail)
+		FrameSetOwner(obj->addr, obj->size, FRAME_SHARED, 0);
 		(void)GlistInsertObject(memory, &obj->node);
 		// 6) Update loaded memory
 		loaded += PAGE_SIZE;
@@ -423,6 +503,168 @@ int32_t LoadMemory(int8_t *data, size_t fileSize, size_t totalSize, glist_t *mem
 	return E_OK;
 }
 
+/*
+ * The elf comes either from the kernel mapping of the RFS (startup script)
+ * or from the spawning process address space
+ */
+static paddr_t LoaderVirtual2Physical(vaddr_t addr)
+{
+	if(MemoryIsLogicalAddr(addr))
+	{
+		return (paddr_t)MemoryL2P(addr);
+	}
+
+	process_t *process = SchedGetRunningProcess();
+
+	return ((process != NULL) ? (MemoryVirtual2physical(process->Memory.pgt, addr)) : (NULL));
+}
+
+/**
+ * LoadInPlace Implementation (See Private function prototypes section for description)
+*/
+int32_t LoadInPlace(segment_t *segment, glist_t *memory)
+{
+	if((segment->type != PT_LOAD) || (segment->size_file == 0) || (segment->size_file != segment->size_mem))
+	{
+		return E_INVAL;
+	}
+
+	if((((uint32_t)segment->data) | ((uint32_t)segment->addr)) & (PAGE_SIZE - 1))
+	{
+		return E_INVAL;
+	}
+
+	size_t size = ROUND_UP(segment->size_file, PAGE_SIZE);
+	paddr_t base = LoaderVirtual2Physical((vaddr_t)segment->data);
+
+	if((base == NULL) || (RfsContains(base, size) == FALSE))
+	{
+		return E_INVAL;
+	}
+
+	// The spawner mapping of the RFS has to be physically contiguous
+	uint32_t offset;
+	for(offset = PAGE_SIZE; offset < size; offset += PAGE_SIZE)
+	{
+		if(LoaderVirtual2Physical((vaddr_t)((uint32_t)segment->data + offset)) != (paddr_t)((uint32_t)base + offset))
+		{
+			return E_INVAL;
+		}
+	}
+
+	mmobj_t *obj = (mmobj_t*)kmalloc(sizeof(mmobj_t));
+	if(obj == NULL)
+	{
+		return E_NO_RES;
+	}
+
+	obj->addr = base;
+	obj->size = size;
+	(void)GlistInsertObject(memory, &obj->node);
+
+	return E_OK;
+}
+
+/**
+ * LoaderFreeText Implementation (See Private function prototypes section for description)
+*/
+void LoaderFreeText(loadInf_t *info)
+{
+	if(info->text.xip == FALSE)
+	{
+		LoaderFreeMemory(&info->text.memory);
+		return;
+	}
+
+	while(info->text.memory.count > 0)
+	{
+		mmobj_t *obj = GLISTNODE2TYPE(GlistRemoveObject(&info->text.memory, NULL), mmobj_t, node);
+		kfree(obj, sizeof(*obj));
+	}
+}
+
+/**
+ * LoadImage Implementation (See Private function prototypes section for description)
+*/
+int32_t LoadImage(segment_t *segment, loadInf_t *info)
+{
+	if(segment->type != PT_LOAD)
+	{
+		return E_OK;
+	}
+
+	info->image.addr = segment->addr;
+	info->image.pages = ROUND_UP(segment->size_mem, PAGE_SIZE) / PAGE_SIZE;
+	info->image.filePages = ROUND_UP(segment->size_file, PAGE_SIZE) / PAGE_SIZE;
+
+	if(info->image.filePages == 0)
+	{
+		return E_OK;
+	}
+
+	info->image.pristine = (paddr_t*)kmalloc(info->image.filePages * sizeof(paddr_t));
+	if(info->image.pristine == NULL)
+	{
+		return E_NO_RES;
+	}
+
+	memset(info->image.pristine, 0x0, info->image.filePages * sizeof(paddr_t));
+
+	int8_t *data = segment->data;
+	size_t loaded = 0;
+	uint32_t page;
+
+	for(page = 0; page < info->image.filePages; page++)
+	{
+		paddr_t paddr = (paddr_t)MemoryGet(PAGE_SIZE, ZONE_INDIRECT);
+		if(paddr == NULL)
+		{
+			LoaderFreeImage(info);
+			return E_NO_RES;
+		}
+
+		vaddr_t vaddr = VirtualSpaceMmap(paddr, PAGE_SIZE);
+		size_t copySize = (((segment->size_file - loaded) >= PAGE_SIZE) ? PAGE_SIZE :  (segment->size_file - loaded));
+		memcpy(vaddr, data, copySize);
+		if(copySize < PAGE_SIZE)
+		{
+			memset((void*)((uint32_t)(vaddr) + copySize), 0x0, (PAGE_SIZE - copySize));
+		}
+		VirtualSpaceUnmmap(vaddr);
+
+		FrameSetOwner(paddr, PAGE_SIZE, FRAME_SHARED, 0);
+		info->image.pristine[page] = paddr;
+		data = (int8_t *)((uint32_t)(data) + PAGE_SIZE);
+		loaded += PAGE_SIZE;
+	}
+
+	return E_OK;
+}
+
+/**
+ * LoaderFreeImage Implementation (See Private function prototypes section for description)
+*/
+void LoaderFreeImage(loadInf_t *info)
+{
+	uint32_t page;
+
+	if(info->image.pristine == NULL)
+	{
+		return;
+	}
+
+	for(page = 0; page < info->image.filePages; page++)
+	{
+		if(info->image.pristine[page] != NULL)
+		{
+			MemoryFree(info->image.pristine[page], PAGE_SIZE);
+		}
+	}
+
+	kfree(info->image.pristine, info->image.filePages * sizeof(paddr_t));
+	info->image.pristine = NULL;
+}
+
 /**
  * LoaderFreeMemory Implementation (See Private function prototypes section for description)
 */
@@ -11,6 +11,13 @@
 #include <scheduler.h>
 #include <kheap.h>
 #include <sleep.h>
+#include <process.h>
+#include <klock.h>
+#include <atomic.h>
+#include <rwlock.h>
+#include <asm.h>
+#include <pmu.h>
+#include <rcu.h>
 
 
 /* Private types ------------------------------------------ */
@@ -23,13 +30,30 @@
 #define MUTEX_UNLOCK		(0)
 #define MUTEX_LOCK			(1)
 
+// Lock words hash to a lock, the same word always uses the same lock
+#define MUTEX_WORD_LOCKS	(16)
+
+// Cycles spent waiting for an owner running on another cpu before blocking
+#ifndef MUTEX_SPIN_CYCLES
+#define MUTEX_SPIN_CYCLES	(10000)
+#endif
+
 /* Private macros ----------------------------------------- */
 #define MUTEX_PRIO_CELLING(mutex)	\
 		(((mutex)->lockQueue.count == 0) ? (0) : (GLISTNODE2TYPE(GlistGetFirst(&(mutex)->lockQueue), task_t, node)->active_prio))
 
+#define MUTEX_WORD_LOCK(word)		(&wordLocks[((uint32_t)(word) >> 2) & (MUTEX_WORD_LOCKS - 1)])
+
 
 /* Private variables -------------------------------------- */
 
+static klock_t wordLocks[MUTEX_WORD_LOCKS];
+
+static struct
+{
+	int32_t		spins;		// Times a locker spun on a running owner
+	int32_t		wins;		// Lock taken after spinning without blocking
+}spinStats;
 
 
 /* Private function prototypes ---------------------------- */
@@ -119,6 +143,188 @@ void MutexResumeTimeout(void* mutex, task_t* task)
 	SchedAddTask(task);
 }
 
+/*
+ * Spin while the owner runs on another cpu, it is likely to release the lock
+ * before blocking and being woken up would take. Returns TRUE if it was released
+ */
+static bool_t MutexSpin(volatile uint32_t *lock, uint32_t unlocked, task_t *owner)
+{
+	if((owner == NULL) || (owner->state != RUNNING))
+	{
+		return FALSE;
+	}
+
+	(void)atomic_inc(&spinStats.spins);
+
+	uint32_t start = PmuCyclesRead();
+
+	while(*lock != unlocked)
+	{
+		// Owner blocked or was preempted, it won't release it soon
+		if((owner->state != RUNNING) || ((PmuCyclesRead() - start) > MUTEX_SPIN_CYCLES))
+		{
+			return FALSE;
+		}
+
+		asm volatile("yield" : : : "memory");
+	}
+
+	return TRUE;
+}
+
+/*
+ * Release the mutex to the first waiter, has to be called with the mutex lock taken.
+ * Returns the new owner that has to be made ready once the lock is released
+ */
+static task_t *MutexHandOver(mutex_t *mutex)
+{
+	// Remove mutex from task owned mutexs
+	GlistRemoveSpecific(&mutex->tnode);
+
+	task_t* nextTask = GLISTNODE2TYPE(GlistRemoveFirst(&mutex->lockQueue), task_t, node);
+
+	if(NULL != nextTask)
+	{
+		mutex->owner = nextTask;
+
+		if(nextTask->timeout.set == TRUE)
+		{
+			TimerStop(nextTask);
+		}
+
+		GlistInsertObject(&nextTask->owned_mutexs, &mutex->tnode);
+	}
+	else
+	{
+		mutex->lock = MUTEX_UNLOCK;
+		mutex->owner = NULL;
+	}
+
+	return nextTask;
+}
+
+/*
+ * Give the mutex to a task or queue it behind the owner, has to be called with
+ * the mutex lock taken. Returns TRUE if the task got the mutex
+ */
+static bool_t MutexAcquireFor(mutex_t *mutex, task_t *task)
+{
+	if(MUTEX_LOCK != mutex->lock)
+	{
+		mutex->lock = MUTEX_LOCK;
+		mutex->owner = task;
+		GlistInsertObject(&task->owned_mutexs, &mutex->tnode);
+
+		return TRUE;
+	}
+
+	GlistInsertObject(&mutex->lockQueue, &task->node);
+
+	if(mutex->owner->active_prio < task->active_prio)
+	{
+		// Solve priority inversion
+		mutex->owner->active_prio = task->active_prio;
+
+		if(mutex->owner->state == READY)
+		{
+			// Remove task from pending list and reinsert it with new priority
+			glist_t *list = (glist_t *)mutex->owner->node.owner;
+			GlistRemoveSpecific(&mutex->owner->node);
+			GlistInsertObject(list, &mutex->owner->node);
+		}
+	}
+
+	return FALSE;
+}
+
+/*
+ * Wait queue of a user lock word, has to be called with the word lock taken
+ */
+static mutex_t *MutexWordQueue(process_t *process, uint32_t *word, bool_t create)
+{
+	mutex_t *mutex;
+
+	ReadLock(&process->mutexs.lock);
+
+	for(mutex = GLIST_FIRST(&process->mutexs, mutex_t, pnode); mutex != NULL; mutex = GLIST_NEXT(&mutex->pnode, mutex_t, pnode))
+	{
+		if(mutex->word == word)
+		{
+			break;
+		}
+	}
+
+	ReadUnlock(&process->mutexs.lock);
+
+	if((mutex != NULL) || (create == FALSE))
+	{
+		return mutex;
+	}
+
+	mutex = (mutex_t*)kmalloc(sizeof(mutex_t));
+
+	if(mutex == NULL)
+	{
+		return NULL;
+	}
+
+	mutex->magic = MUTEX_MAGIC;
+	mutex->lock = MUTEX_LOCK;
+	mutex->owner = NULL;
+	mutex->word = word;
+	mutex->tnode.owner = NULL;
+
+	spinlock_init(&mutex->spinLock);
+
+	GlistInitialize(&mutex->lockQueue, GList);
+	GlistSetSort(&mutex->lockQueue, ReadyListSort);
+
+	GlistInsertObject(&process->mutexs, &mutex->pnode);
+
+	return mutex;
+}
+
+static void MutexWordSetOwner(mutex_t *mutex, task_t *owner)
+{
+	if(mutex->owner == owner)
+	{
+		return;
+	}
+
+	GlistRemoveSpecific(&mutex->tnode);
+	mutex->owner = owner;
+
+	if(owner != NULL)
+	{
+		GlistInsertObject(&owner->owned_mutexs, &mutex->tnode);
+	}
+}
+
+void MutexWordResumeTimeout(void* mutex, task_t* task)
+{
+	mutex_t* mx = (mutex_t*)mutex;
+	klock_t* lock = MUTEX_WORD_LOCK(mx->word);
+
+	uint32_t state;
+	Klock(lock, &state);
+
+	// Once handed over the task can already be waiting on something else
+	if((task->node.owner != (void*)&mx->lockQueue) || (GlistRemoveSpecific(&task->node) != E_OK))
+	{
+		// Lock was handed over before the timeout
+		Kunlock(lock, &state);
+
+		return;
+	}
+
+	// The waiters flag stays set, the owner will find an empty queue on unlock
+	task->ret = E_TIMED_OUT;
+
+	Kunlock(lock, &state);
+
+	SchedAddTask(task);
+}
+
 /* Private functions -------------------------------------- */
 
 int32_t MutexListSort(glistNode_t* current, glistNode_t* newmutex)
@@ -137,6 +343,7 @@ mutex_t *MutexCreate()
 	mutex->magic = MUTEX_MAGIC;
 	mutex->lock = MUTEX_UNLOCK;
 	mutex->owner = NULL;
+	mutex->word = NULL;
 
 	spinlock_init(&mutex->spinLock);
 
@@ -183,6 +390,14 @@ int32_t MutexLock(mutex_t *mutex)
 		return E_INVAL;
 	}
 
+	// Waiting tasks get the lock first, only spin if there are none
+	bool_t spun = FALSE;
+
+	if((MUTEX_LOCK == mutex->lock) && GLIST_EMPTY(&mutex->lockQueue))
+	{
+		spun = MutexSpin(&mutex->lock, MUTEX_UNLOCK, mutex->owner);
+	}
+
 	spinlock_irq(&mutex->spinLock, &state);
 
 	if(MUTEX_LOCK == mutex->lock)
@@ -228,6 +443,11 @@ int32_t MutexLock(mutex_t *mutex)
 	GlistInsertObject(&task->owned_mutexs, &mutex->tnode);
 	spinunlock_irq(&mutex->spinLock, &state);
 
+	if(spun == TRUE)
+	{
+		(void)atomic_inc(&spinStats.wins);
+	}
+
 	return E_OK;
 }
 
@@ -251,32 +471,14 @@ int32_t MutexUnlock(mutex_t *mutex)
 
 	spinlock_irq(&mutex->spinLock, &state);
 
-	// Remove mutex from task owned mutexs
-	GlistRemoveSpecific(&mutex->tnode);
+	task_t* nextTask = MutexHandOver(mutex);
 
-	task_t* nextTask = GLISTNODE2TYPE(GlistRemoveFirst(&mutex->lockQueue), task_t, node);
+	spinunlock_irq(&mutex->spinLock, &state);
 
 	if(NULL != nextTask)
 	{
-		mutex->owner = nextTask;
-
-		if(nextTask->timeout.set == TRUE)
-		{
-			TimerStop(nextTask);
-		}
-
-		GlistInsertObject(&nextTask->owned_mutexs, &mutex->tnode);
-
-		spinunlock_irq(&mutex->spinLock, &state);
-
 		SchedAddTask(nextTask);
 	}
-	else
-	{
-		mutex->lock = MUTEX_UNLOCK;
-		mutex->owner = NULL;
-		spinunlock_irq(&mutex->spinLock, &state);
-	}
 
 	// TODO: Resolve priority
 //	uint16_t next_prio = task->real_prio;
@@ -372,6 +574,315 @@ int32_t MutexDestroy(mutex_t *mutex)
 	return E_OK;
 }
 
+int32_t MutexCondWait(mutex_t *mutex, glist_t *queue, void (*timeout)(void*,task_t*), void *arg)
+{
+	task_t *task = SchedGetRunningTask();
+
+	if(MUTEX_LOCK != mutex->lock || mutex->owner != task)
+	{
+		return E_INVAL;
+	}
+
+	uint32_t state = 0;
+
+	// Signallers requeue under the mutex lock, they can't see us before the mutex is released
+	spinlock_irq(&mutex->spinLock, &state);
+
+	GlistInsertObject(queue, &task->node);
+
+	if(task->timeout.set == TRUE)
+	{
+		TimerSet(task, timeout, arg);
+	}
+
+	task_t *nextTask = MutexHandOver(mutex);
+
+	// Lock scheduler to suspend task
+	SchedLock(NULL);
+
+	spinunlock(&mutex->spinLock);
+
+	if(NULL != nextTask)
+	{
+		SchedAddTask(nextTask);
+	}
+
+	if(task->real_prio < task->active_prio)
+	{
+		task->active_prio = task->real_prio;
+	}
+
+	int32_t ret = SchedStopRunningTask(BLOCKED, COND);
+
+	// We still have interrupts disable for this task so we have to enable them
+	critical_unlock(&state);
+
+	return ret;
+}
+
+int32_t MutexCondRequeue(mutex_t *mutex, glist_t *queue, int32_t count)
+{
+	uint32_t state = 0;
+	task_t *wake = NULL;
+
+	spinlock_irq(&mutex->spinLock, &state);
+
+	if((count == 0) || (count > (int32_t)queue->count))
+	{
+		count = (int32_t)queue->count;
+	}
+
+	for(; count > 0; --count)
+	{
+		task_t *task = GLISTNODE2TYPE(GlistRemoveFirst(queue), task_t, node);
+
+		if(task == NULL)
+		{
+			break;
+		}
+
+		// Signalled, the timeout no longer applies while waiting for the mutex
+		if(task->timeout.set == TRUE)
+		{
+			TimerStop(task);
+		}
+
+		task->ret = E_OK;
+
+		// Only one can get the mutex, the others wait on the mutex queue for the owner to hand it over
+		if(MutexAcquireFor(mutex, task) == TRUE)
+		{
+			wake = task;
+		}
+	}
+
+	spinunlock_irq(&mutex->spinLock, &state);
+
+	if(wake != NULL)
+	{
+		SchedAddTask(wake);
+	}
+
+	return ((wake != NULL) ? (1) : (0));
+}
+
+void MutexWordInit(void)
+{
+	uint32_t i;
+
+	for(i = 0; i < MUTEX_WORD_LOCKS; i++)
+	{
+		KlockInit(&wordLocks[i]);
+		KlockName(&wordLocks[i], "mutexWord");
+	}
+}
+
+int32_t MutexWordLock(uint32_t *word)
+{
+	process_t *process = SchedGetRunningProcess();
+
+	// The word is read and changed from the kernel
+	if(!ProcessUserWordValid(process, word))
+	{
+		return E_INVAL;
+	}
+
+	task_t *task = SchedGetRunningTask();
+	uint32_t owner = MUTEX_WORD_OWNER(task->tid);
+	klock_t *lock = MUTEX_WORD_LOCK(word);
+	uint32_t value = *word;
+	bool_t spun = FALSE;
+
+	// With waiters the lock is handed over to them, only spin if there are none
+	if((value != MUTEX_WORD_FREE) && !(value & MUTEX_WORD_WAITERS) && ((value & MUTEX_WORD_OWNER_MASK) != owner))
+	{
+		task_t *holder = ProcessGetTask(process, (uint32_t)((process->pid << 16) | ((value & MUTEX_WORD_OWNER_MASK) - 1)));
+		spun = MutexSpin(word, MUTEX_WORD_FREE, holder);
+	}
+
+	uint32_t state;
+	Klock(lock, &state);
+
+	mutex_t *mutex = MutexWordQueue(process, word, FALSE);
+
+	while(TRUE)
+	{
+		value = *word;
+
+		if(value == MUTEX_WORD_FREE)
+		{
+			// Released before we got here, keep the flag if there are still tasks waiting
+			uint32_t locked = owner | (((mutex != NULL) && !GLIST_EMPTY(&mutex->lockQueue)) ? MUTEX_WORD_WAITERS : 0);
+
+			if(atomic_cmp_set(word, value, locked) == E_OK)
+			{
+				if(mutex != NULL)
+				{
+					MutexWordSetOwner(mutex, task);
+				}
+
+				Kunlock(lock, &state);
+
+				if(spun == TRUE)
+				{
+					(void)atomic_inc(&spinStats.wins);
+				}
+
+				return E_OK;
+			}
+
+			continue;
+		}
+
+		if((value & MUTEX_WORD_OWNER_MASK) == owner)
+		{
+			Kunlock(lock, &state);
+
+			return E_INVAL;
+		}
+
+		// Owner unlock in user space will fail from now on
+		if((value & MUTEX_WORD_WAITERS) || (atomic_cmp_set(word, value, value | MUTEX_WORD_WAITERS) == E_OK))
+		{
+			break;
+		}
+	}
+
+	if((mutex == NULL) && ((mutex = MutexWordQueue(process, word, TRUE)) == NULL))
+	{
+		Kunlock(lock, &state);
+
+		return E_NO_MEMORY;
+	}
+
+	// Owner only known to the kernel from the lock word
+	task_t *holder = ProcessGetTask(process, (uint32_t)((process->pid << 16) | ((value & MUTEX_WORD_OWNER_MASK) - 1)));
+	MutexWordSetOwner(mutex, holder);
+
+	GlistInsertObject(&mutex->lockQueue, &task->node);
+
+	if((holder != NULL) && (holder->active_prio < task->active_prio))
+	{
+		// Solve priority inversion
+		holder->active_prio = task->active_prio;
+
+		if(holder->state == READY)
+		{
+			// Remove task from pending list and reinsert it with new priority
+			glist_t *list = (glist_t *)holder->node.owner;
+			GlistRemoveSpecific(&holder->node);
+			GlistInsertObject(list, &holder->node);
+		}
+	}
+
+	if(task->timeout.set == TRUE)
+	{
+		TimerSet(task, MutexWordResumeTimeout, mutex);
+	}
+
+	// Lock scheduler to suspend task
+	SchedLock(NULL);
+
+	Kunlock(lock, NULL);
+
+	int32_t ret = SchedStopRunningTask(BLOCKED, MUTEX);
+
+	// We still have interrupts disable for this task so we have to enable them
+	critical_unlock(&state);
+
+	return ret;
+}
+
+int32_t MutexWordUnlock(uint32_t *word)
+{
+	process_t *process = SchedGetRunningProcess();
+
+	if(!ProcessUserWordValid(process, word))
+	{
+		return E_INVAL;
+	}
+
+	task_t *task = SchedGetRunningTask();
+	klock_t *lock = MUTEX_WORD_LOCK(word);
+
+	uint32_t state;
+	Klock(lock, &state);
+
+	if((*word & MUTEX_WORD_OWNER_MASK) != MUTEX_WORD_OWNER(task->tid))
+	{
+		Kunlock(lock, &state);
+
+		return E_ERROR;
+	}
+
+	mutex_t *mutex = MutexWordQueue(process, word, FALSE);
+	task_t *next = NULL;
+
+	if(mutex != NULL)
+	{
+		next = GLISTNODE2TYPE(GlistRemoveFirst(&mutex->lockQueue), task_t, node);
+	}
+
+	if(next != NULL)
+	{
+		if(next->timeout.set == TRUE)
+		{
+			TimerStop(next);
+		}
+
+		// Hand over, nobody can take it in user space in between
+		*word = (MUTEX_WORD_OWNER(next->tid) | (GLIST_EMPTY(&mutex->lockQueue) ? 0 : MUTEX_WORD_WAITERS));
+		dmb();
+
+		MutexWordSetOwner(mutex, next);
+		next->ret = E_OK;
+	}
+	else
+	{
+		*word = MUTEX_WORD_FREE;
+		dmb();
+
+		// No one waiting, the queue is created again on the next contention
+		if(mutex != NULL)
+		{
+			GlistRemoveSpecific(&mutex->tnode);
+			GlistRemoveSpecific(&mutex->pnode);
+			// A timeout handler that lost the race can still be looking at it
+			RcuFree(mutex, sizeof(*mutex));
+		}
+	}
+
+	Kunlock(lock, &state);
+
+	bool_t yield = FALSE;
+
+	if(task->real_prio < task->active_prio)
+	{
+		// Priority inherited from the waiters
+		task->active_prio = task->real_prio;
+		yield = TRUE;
+	}
+
+	if(next != NULL)
+	{
+		// Preempts a lower priority cpu if needed
+		SchedAddTask(next);
+	}
+
+	// Only give up the cpu if our priority dropped
+	if(yield == TRUE)
+	{
+		SchedYield();
+	}
+
+	return E_OK;
+}
+
+void MutexGetSpinStats(uint32_t *spins, uint32_t *wins)
+{
+	*spins = (uint32_t)spinStats.spins;
+	*wins = (uint32_t)spinStats.wins;
+}
 
 void MutexPriorityAdjust(task_t* task, uint16_t prio)
 {
@@ -14,6 +14,8 @@
 #include <string.h>
 #include <kheap.h>
 #include <memmgr.h>
+#include <kvspace.h>
+#include <frame.h>
 
 #include <misc.h>
 #include <mmu.h>
@@ -25,6 +27,7 @@
 
 #include <scheduler.h>
 #include <ipc_2.h>
+#include <rcu.h>
 
 /* Private types ------------------------------------------ */
 
@@ -32,6 +35,7 @@
 /* Private constants -------------------------------------- */
 
 #define MAIN_TASK_ID		(0)
+#define LARGE_PAGE_PAGES	(LARGE_PAGE_SIZE / PAGE_SIZE)
 #define TASKS_POOL_SIZE		(4 * sizeof(task_t))
 #define TASKS_POOL_FLAGS	(ALLOCATOR_CLEAN_MEMORY | ALLOCATOR_ALLOW_EXPAND)
 
@@ -70,6 +74,8 @@ static uint32_t ProcessMapSection(pgt_t pgt, glist_t *memory, vaddr_t baseAddr,
 				mapType,
 				memcfg);
 
+		FrameMap(obj->addr, obj->size);
+
 		mapped += ALIGN_UP(obj->size, PAGE_SIZE);
 		vaddr = (vaddr_t)((uint32_t)vaddr + obj->size);
 		obj = GLIST_NEXT(&obj->node, mmobj_t, node);
@@ -78,6 +84,26 @@ static uint32_t ProcessMapSection(pgt_t pgt, glist_t *memory, vaddr_t baseAddr,
 	return mapped;
 }
 
+/*
+ * Virtual alignment that lets memory starting at paddr be mapped with the
+ * biggest pages its size allows. Sections are only worth it for memory we
+ * already have, on demand objects fault in large pages at most
+ */
+static size_t ProcessMapAlignment(paddr_t paddr, size_t size)
+{
+	if((paddr != NULL) && (size >= SECTION_SIZE) && !((uint32_t)paddr & (SECTION_SIZE - 1)))
+	{
+		return SECTION_SIZE;
+	}
+
+	if((size >= LARGE_PAGE_SIZE) && !((uint32_t)paddr & (LARGE_PAGE_SIZE - 1)))
+	{
+		return LARGE_PAGE_SIZE;
+	}
+
+	return PAGE_SIZE;
+}
+
 int32_t PrivObjectCmp(glistNode_t* node, void* addr)
 {
 	pobj_t* obj = GLISTNODE2TYPE(node, pobj_t, node);
@@ -103,6 +129,8 @@ static int32_t ProcessMemoryInit(process_t *proc, procAttr_t *attr)
 {
 	// Get a Page Table for the process
 	proc->Memory.pgt = PageTableAlloc();
+	// The ASID is assigned when the process first runs
+	proc->Memory.asid = 0;
 
 	// Generate Tasks stack base address and area size
 	// Get stack memory area size
@@ -152,12 +180,22 @@ static int32_t ProcessMemoryInit(process_t *proc, procAttr_t *attr)
 			proc->exec.load->text.addr,
 			PAGE_USER_TEXT, NULL);
 
-	// Map .data + .bss sections
-	proc->Memory.memUsed += ProcessMapSection(
-			proc->Memory.pgt,
-			&proc->exec.private.dataMemory,
-			((proc->exec.load->data.addr != NULL) ? (proc->exec.load->data.addr) : (proc->exec.load->bss.addr)),
-			PAGE_USER_DATA, NULL);
+	// Map the shared .data image read only, the first write gives the process
+	// its own copy. The .bss pages are left unmapped and zero filled on demand
+	uint32_t page;
+	for(page = 0; page < proc->exec.load->image.filePages; page++)
+	{
+		vPageMapMemory(
+				NULL,
+				proc->Memory.pgt,
+				proc->exec.load->image.pristine[page],
+				(vaddr_t)((uint32_t)proc->exec.load->image.addr + (page * PAGE_SIZE)),
+				PAGE_SIZE,
+				PAGE_USER_COW,
+				NULL);
+
+		FrameMap(proc->exec.load->image.pristine[page], PAGE_SIZE);
+	}
 
 	return E_OK;
 }
@@ -167,14 +205,20 @@ static void ProcessCleanPrivateMemory(glist_t* privList)
 	while(!GLIST_EMPTY(privList))
 	{
 		pobj_t* priv = GLISTNODE2TYPE(GlistRemoveFirst(privList), pobj_t, node);
+		uint32_t parts = priv->parts;
 
 		while(--priv->parts >= 0)
 		{
-			MemoryFree((ptr_t)priv->memory[priv->parts].data, priv->memory[priv->parts].size);
+			// On demand objects may have pages that were never touched
+			if(priv->memory[priv->parts].data != NULL)
+			{
+				FrameUnmap((paddr_t)priv->memory[priv->parts].data, priv->memory[priv->parts].size);
+				MemoryFree((ptr_t)priv->memory[priv->parts].data, priv->memory[priv->parts].size);
+			}
 		}
 
 		vSpaceRelease(priv->vspace);
-		kfree(priv->memory, sizeof(*priv->memory));
+		kfree(priv->memory, sizeof(*priv->memory) * parts);
 		kfree(priv->memcfg, sizeof(*priv->memcfg));
 		kfree(priv, sizeof(*priv));
 	}
@@ -271,6 +315,9 @@ int32_t ProcessCopyConnectionsRange(process_t* parent, process_t* child, uint32_
 		return ProcessCopyConnections(parent, child);
 	}
 
+	// Other parent tasks can detach the connections meanwhile
+	RcuReadLock();
+
 	uint32_t index = 1;
 	for( ; index < fd_count; index++)
 	{
@@ -291,6 +338,7 @@ int32_t ProcessCopyConnectionsRange(process_t* parent, process_t* child, uint32_
 		clink->connection = connection->connection;
 		clink->flags = connection->flags;
 		clink->refs = 1;
+		clink->pulses = 0;
 		clink->pid = child->pid;
 		// TODO: In the future we will also copy the mappings
 		clink->privMap = NULL;
@@ -299,11 +347,16 @@ int32_t ProcessCopyConnectionsRange(process_t* parent, process_t* child, uint32_
 		VectorInsertAt(&child->connections, clink, index);
 	}
 
+	RcuReadUnlock();
+
 	return E_OK;
 }
 
 int32_t ProcessCopyConnections(process_t* parent, process_t* child)
 {
+	// Other parent tasks can detach the connections meanwhile
+	RcuReadLock();
+
 	uint32_t count = VectorUsage(&parent->connections) - 1;
 	uint32_t index = 1;
 	for( ; count > 0; index++)
@@ -328,6 +381,7 @@ int32_t ProcessCopyConnections(process_t* parent, process_t* child)
 		clink->connection = connection->connection;
 		clink->flags = connection->flags;
 		clink->refs = 1;
+		clink->pulses = 0;
 		clink->pid = child->pid;
 		clink->coid = (int32_t)index;
 		// TODO: In the future we will also copy the mappings
@@ -336,11 +390,14 @@ int32_t ProcessCopyConnections(process_t* parent, process_t* child)
 
 		if(VectorInsertAt(&child->connections, clink, index) != index)
 		{
+			RcuReadUnlock();
 			// This should never happen!!!
 			return E_ERROR;
 		}
 	}
 
+	RcuReadUnlock();
+
 	return E_OK;
 }
 
@@ -442,8 +499,12 @@ void ProcessMemoryClean(process_t *process)
 	// Clean Stacks section
 	sManagerDestroy(&process->Memory.stacksManager);
 
-	// Free MMU Page Table
-	PageTableDealloc(process->pid, process->Memory.pgt);
+	// No cpu can skip the switch to a new process allocated in the same place
+	SchedVirtualSpaceDrop(process);
+
+	// Free MMU Page Table, the ASID can only be reused after the TLB is clean
+	PageTableDealloc(AsidHardware(&process->Memory.asid), process->Memory.pgt);
+	AsidRelease(&process->Memory.asid);
 }
 
 /**
@@ -479,6 +540,9 @@ void ProcessTerminate(process_t *process)
 	// We start by closing the IPC channels and connections to avoid conflicts
 	// With ongoing communications trying to resume tasks blocked in the IPC
 
+	// Interrupts delivered as pulses hold references to the process connections
+	InterruptProcessClean(process);
+
 	// Close all open IPC Channels
 	uint32_t count = VectorUsage(&process->channels);
 	uint32_t index = 0;
@@ -568,16 +632,20 @@ vaddr_t ProcessRegisterPrivMemory(process_t* process, mbv_t* memory, int32_t par
 	privobj->memory = memory;
 	privobj->parts = parts;
 	privobj->size = size;
-	// Get Virtual space from the mmap area
-	privobj->vspace = vSpaceReserve(&process->Memory.mmapManager, size);
+	// Get Virtual space from the mmap area, aligned so the biggest part can use large pages
+	privobj->vspace = vSpaceReserveAligned(&process->Memory.mmapManager, size, ProcessMapAlignment((paddr_t)memory[0].data, memory[0].size));
 	privobj->vaddr = privobj->vspace->base;
 	privobj->memcfg = memcfg;
 	privobj->refs = 0;
+	privobj->flags = 0;
 
 	int32_t i;
 	for(i = 0; i < parts; i++)
 	{
 		vSpaceMapSection(privobj->vspace, (paddr_t)memory[i].data, memory[i].size, PAGE_CUSTOM, memcfg);
+		FrameSetOwner((paddr_t)memory[i].data, memory[i].size, FRAME_USER, process->pid);
+		FrameMap((paddr_t)memory[i].data, memory[i].size);
+		process->Memory.memUsed += memory[i].size;
 	}
 
 	// Insert in private memory objects list
@@ -586,6 +654,368 @@ vaddr_t ProcessRegisterPrivMemory(process_t* process, mbv_t* memory, int32_t par
 	return privobj->vaddr;
 }
 
+vaddr_t ProcessReservePrivMemory(process_t* process, size_t size, memCfg_t* memcfg)
+{
+	size = ROUND_UP(size, PAGE_SIZE);
+
+	uint32_t pages = (size / PAGE_SIZE);
+	mbv_t* memory = (mbv_t*)kmalloc(sizeof(mbv_t) * pages);
+
+	if(memory == NULL)
+	{
+		kfree(memcfg, sizeof(*memcfg));
+		return NULL;
+	}
+
+	pobj_t* privobj = (pobj_t*)kmalloc(sizeof(pobj_t));
+
+	if(privobj == NULL)
+	{
+		kfree(memory, sizeof(mbv_t) * pages);
+		kfree(memcfg, sizeof(*memcfg));
+		return NULL;
+	}
+
+	privobj->vspace = vSpaceReserveAligned(&process->Memory.mmapManager, size, ProcessMapAlignment(NULL, size));
+
+	if(privobj->vspace == NULL)
+	{
+		kfree(memory, sizeof(mbv_t) * pages);
+		kfree(memcfg, sizeof(*memcfg));
+		kfree(privobj, sizeof(*privobj));
+		return NULL;
+	}
+
+	uint32_t i;
+	for(i = 0; i < pages; i++)
+	{
+		memory[i].data = NULL;
+		memory[i].size = PAGE_SIZE;
+	}
+
+	privobj->memory = memory;
+	privobj->parts = pages;
+	privobj->size = size;
+	privobj->vaddr = privobj->vspace->base;
+	privobj->memcfg = memcfg;
+	privobj->refs = 0;
+	privobj->flags = POBJ_ONDEMAND;
+
+	// Insert in private memory objects list
+	GlistInsertObject(&process->Memory.privList, &privobj->node);
+
+	return privobj->vaddr;
+}
+
+/*
+ * Allocate, zero and map one page of an on demand object.
+ * Called with the mmap manager lock held
+ */
+/*
+ * Get new memory filled with the contents of src or with zeros if src is NULL.
+ * Blocks bigger than a page are aligned to their size
+ */
+static paddr_t PagesGet(size_t size, paddr_t src)
+{
+	paddr_t paddr = ((size > PAGE_SIZE) ? MemoryGetAligned(size, size, ZONE_INDIRECT) : MemoryGet(size, ZONE_INDIRECT));
+
+	if(paddr == NULL)
+	{
+		return NULL;
+	}
+
+	ptr_t laddr = MemoryP2L(paddr);
+	vaddr_t vaddr = ((laddr != NULL) ? (vaddr_t)laddr : VirtualSpaceMmap(paddr, size));
+
+	if(src != NULL)
+	{
+		vaddr_t vsrc = VirtualSpaceMmap(src, size);
+		memcpy(vaddr, vsrc, size);
+		VirtualSpaceUnmmap(vsrc);
+	}
+	else
+	{
+		memset(vaddr, 0x0, size);
+	}
+
+	if(laddr == NULL)
+	{
+		VirtualSpaceUnmmap(vaddr);
+	}
+
+	return paddr;
+}
+
+/*
+ * Fault in a whole large page worth of an on demand object. Only done when
+ * the chunk is virtually aligned, fully inside the object and untouched
+ */
+static int32_t PrivObjectLargePageIn(process_t* process, pobj_t* obj, uint32_t chunk)
+{
+	vaddr_t vaddr = (vaddr_t)((uint32_t)obj->vaddr + (chunk * PAGE_SIZE));
+	uint32_t page;
+
+	if(((uint32_t)vaddr & (LARGE_PAGE_SIZE - 1)) || ((chunk + LARGE_PAGE_PAGES) > (uint32_t)obj->parts))
+	{
+		return E_INVAL;
+	}
+
+	for(page = chunk; page < (chunk + LARGE_PAGE_PAGES); page++)
+	{
+		if(obj->memory[page].data != NULL)
+		{
+			return E_BUSY;
+		}
+	}
+
+	paddr_t paddr = PagesGet(LARGE_PAGE_SIZE, NULL);
+
+	if(paddr == NULL)
+	{
+		return E_NO_MEMORY;
+	}
+
+	(void)vPageMapMemory(
+			&process->Memory.mmapManager.lock,
+			process->Memory.pgt,
+			paddr,
+			vaddr,
+			LARGE_PAGE_SIZE,
+			PAGE_CUSTOM,
+			obj->memcfg);
+
+	FrameSetOwner(paddr, LARGE_PAGE_SIZE, FRAME_USER, process->pid);
+	FrameMap(paddr, LARGE_PAGE_SIZE);
+
+	// The chunk head owns the memory, the other pages of the chunk become empty parts
+	obj->memory[chunk].data = paddr;
+	obj->memory[chunk].size = LARGE_PAGE_SIZE;
+	for(page = chunk + 1; page < (chunk + LARGE_PAGE_PAGES); page++)
+	{
+		obj->memory[page].size = 0;
+	}
+
+	process->Memory.memUsed += LARGE_PAGE_SIZE;
+
+	return E_OK;
+}
+
+static int32_t PrivObjectPageIn(process_t* process, pobj_t* obj, uint32_t page)
+{
+	uint32_t chunk = ALIGN_DOWN(page, LARGE_PAGE_PAGES);
+
+	if((obj->memory[page].data != NULL) || (obj->memory[page].size == 0))
+	{
+		// Another task got here first
+		return E_OK;
+	}
+
+	if(PrivObjectLargePageIn(process, obj, chunk) == E_OK)
+	{
+		return E_OK;
+	}
+
+	paddr_t paddr = PagesGet(PAGE_SIZE, NULL);
+
+	if(paddr == NULL)
+	{
+		return E_NO_MEMORY;
+	}
+
+	(void)vPageMapMemory(
+			&process->Memory.mmapManager.lock,
+			process->Memory.pgt,
+			paddr,
+			(vaddr_t)((uint32_t)obj->vaddr + (page * PAGE_SIZE)),
+			PAGE_SIZE,
+			PAGE_CUSTOM,
+			obj->memcfg);
+
+	FrameSetOwner(paddr, PAGE_SIZE, FRAME_USER, process->pid);
+	FrameMap(paddr, PAGE_SIZE);
+
+	obj->memory[page].data = paddr;
+	process->Memory.memUsed += PAGE_SIZE;
+
+	return E_OK;
+}
+
+/*
+ * Writable segment page holding addr or -1 if addr is outside the segment
+ */
+static int32_t ProcessImagePage(process_t* process, vaddr_t addr)
+{
+	loadInf_t* load = process->exec.load;
+
+	if((addr < load->image.addr) || (addr >= (vaddr_t)((uint32_t)load->image.addr + (load->image.pages * PAGE_SIZE))))
+	{
+		return -1;
+	}
+
+	return (int32_t)(((uint32_t)addr - (uint32_t)load->image.addr) / PAGE_SIZE);
+}
+
+/*
+ * Give the process its own copy of a writable segment page. Pages backed by
+ * the file are copied from the shared image, .bss pages start zeroed
+ */
+static int32_t ImagePageIn(process_t* process, uint32_t page)
+{
+	loadInf_t* load = process->exec.load;
+
+	if(process->exec.private.pages[page] != NULL)
+	{
+		// Another task got here first
+		return E_OK;
+	}
+
+	paddr_t paddr = PagesGet(PAGE_SIZE, (page < load->image.filePages) ? (load->image.pristine[page]) : (NULL));
+
+	if(paddr == NULL)
+	{
+		return E_NO_MEMORY;
+	}
+
+	vaddr_t vaddr = (vaddr_t)((uint32_t)load->image.addr + (page * PAGE_SIZE));
+
+	// Replaces the read only mapping of the shared page
+	(void)vPageMapMemory(
+			&process->Memory.mmapManager.lock,
+			process->Memory.pgt,
+			paddr,
+			vaddr,
+			PAGE_SIZE,
+			PAGE_USER_DATA,
+			NULL);
+
+	// The map only drops the entry tagged with the ASID the cpu runs with, IPC
+	// copies fault pages in for another process
+	uint32_t asid = AsidHardware(&process->Memory.asid);
+
+	if(asid != 0)
+	{
+		MemoryVmaSynchronize(vaddr, PAGE_SIZE, asid, MEMORY_SYNC_TLB);
+	}
+
+	if(page < load->image.filePages)
+	{
+		FrameUnmap(load->image.pristine[page], PAGE_SIZE);
+	}
+
+	FrameSetOwner(paddr, PAGE_SIZE, FRAME_USER, process->pid);
+	FrameMap(paddr, PAGE_SIZE);
+
+	process->exec.private.pages[page] = paddr;
+	process->Memory.memUsed += PAGE_SIZE;
+
+	return E_OK;
+}
+
+int32_t ProcessPageFault(process_t* process, vaddr_t addr, bool_t protection)
+{
+	int32_t ret = E_FAULT;
+	uint32_t status;
+
+	Klock(&process->Memory.mmapManager.lock, &status);
+
+	int32_t page = ProcessImagePage(process, addr);
+
+	if(page >= 0)
+	{
+		ret = ImagePageIn(process, (uint32_t)page);
+		Kunlock(&process->Memory.mmapManager.lock, &status);
+		return ret;
+	}
+
+	pobj_t* obj = GLIST_FIRST(&process->Memory.privList, pobj_t, node);
+
+	// On demand objects only miss translations, a write to a read only
+	// object is a real fault
+	for(; (obj != NULL) && (protection == FALSE); obj = GLIST_NEXT(&obj->node, pobj_t, node))
+	{
+		if((obj->flags & POBJ_ONDEMAND) && (addr >= obj->vaddr) && (addr < (obj->vaddr + obj->size)))
+		{
+			ret = PrivObjectPageIn(process, obj, ((uint32_t)addr - (uint32_t)obj->vaddr) / PAGE_SIZE);
+			break;
+		}
+	}
+
+	Kunlock(&process->Memory.mmapManager.lock, &status);
+
+	return ret;
+}
+
+int32_t ProcessPopulatePrivObject(process_t* process, pobj_t* obj)
+{
+	if(!(obj->flags & POBJ_ONDEMAND))
+	{
+		return E_OK;
+	}
+
+	int32_t ret = E_OK;
+	uint32_t status;
+	int32_t page;
+
+	Klock(&process->Memory.mmapManager.lock, &status);
+
+	for(page = 0; (page < obj->parts) && (ret == E_OK); page++)
+	{
+		ret = PrivObjectPageIn(process, obj, page);
+	}
+
+	Kunlock(&process->Memory.mmapManager.lock, &status);
+
+	return ret;
+}
+
+paddr_t ProcessVirtual2Physical(process_t* process, vaddr_t addr, bool_t write)
+{
+	paddr_t paddr = MemoryVirtual2physical(process->Memory.pgt, addr);
+	int32_t page = ProcessImagePage(process, addr);
+
+	// Writes through the kernel mapping must not land on the shared image
+	bool_t shared = ((write == TRUE) && (page >= 0) && (process->exec.private.pages[page] == NULL));
+
+	if(((paddr == NULL) || shared) && (ProcessPageFault(process, addr, (paddr != NULL)) == E_OK))
+	{
+		paddr = MemoryVirtual2physical(process->Memory.pgt, addr);
+	}
+
+	return paddr;
+}
+
+bool_t ProcessUserWordValid(process_t* process, uint32_t* word)
+{
+	if((word == NULL) || ((uint32_t)word & 0x3))
+	{
+		return FALSE;
+	}
+
+	// Text and read only objects are also mapped, the page permissions decide
+	if(ProcessVirtual2Physical(process, (vaddr_t)word, TRUE) == NULL)
+	{
+		return FALSE;
+	}
+
+	return MemoryUserWritable(process->Memory.pgt, (vaddr_t)word);
+}
+
+bool_t ProcessUserWordReadable(process_t* process, const uint32_t* word)
+{
+	if((word == NULL) || ((uint32_t)word & 0x3))
+	{
+		return FALSE;
+	}
+
+	// Pages not touched yet are faulted in, only the permissions are checked
+	if(ProcessVirtual2Physical(process, (vaddr_t)word, FALSE) == NULL)
+	{
+		return FALSE;
+	}
+
+	return MemoryUserReadable(process->Memory.pgt, (vaddr_t)word);
+}
+
 //sref_t* ProcessRegisterShareMemory(process_t* process, uint32_t coid, mbv_t* memory, int32_t parts, size_t size, memCfg_t* memcfg)
 sref_t* ProcessRegisterShareMemory(process_t* process, uint32_t coid, sobj_t* sobj, memCfg_t* memcfg)
 {
@@ -593,13 +1023,22 @@ sref_t* ProcessRegisterShareMemory(process_t* process, uint32_t coid, sobj_t* so
 	sref->coid = coid;
 	sref->shared = sobj;
 	sref->map.size = sobj->obj->size;
-	sref->map.vspace = vSpaceReserve(&process->Memory.mmapManager, sref->map.size);
+	sref->map.vspace = vSpaceReserveAligned(
+			&process->Memory.mmapManager,
+			sref->map.size,
+			ProcessMapAlignment((paddr_t)sobj->obj->memory[0].data, sobj->obj->memory[0].size));
 	sref->map.vaddr = sref->map.vspace->base;
 	sref->map.memcfg = memcfg;
 
 	int32_t i;
 	for(i = 0; i < sobj->obj->parts; i++)
 	{
+		// Pages covered by a large page of the object are empty parts
+		if(sobj->obj->memory[i].size == 0)
+		{
+			continue;
+		}
+
 		vSpaceMapSection(sref->map.vspace, (paddr_t)sobj->obj->memory[i].data, sobj->obj->memory[i].size, PAGE_CUSTOM, memcfg);
 	}
 
@@ -642,15 +1081,29 @@ int32_t ProcessCleanPrivateObject(pobj_t* obj)
 		return E_BUSY;
 	}
 
+	process_t* process = GLIST_OWNER(&obj->node, process_t, Memory.privList);
+	uint32_t status;
+
+	// Keep page faults from other tasks away while the object goes
+	Klock(&process->Memory.mmapManager.lock, &status);
+
 	if(GlistRemoveSpecific(&obj->node) != E_OK)
 	{
+		Kunlock(&process->Memory.mmapManager.lock, &status);
 		return E_INVAL;
 	}
 
+	Kunlock(&process->Memory.mmapManager.lock, &status);
+
 	uint32_t i = obj->parts;
 	while(--obj->parts >= 0)
 	{
-		MemoryFree((ptr_t)obj->memory[obj->parts].data, obj->memory[obj->parts].size);
+		if(obj->memory[obj->parts].data != NULL)
+		{
+			FrameUnmap((paddr_t)obj->memory[obj->parts].data, obj->memory[obj->parts].size);
+			MemoryFree((ptr_t)obj->memory[obj->parts].data, obj->memory[obj->parts].size);
+			process->Memory.memUsed -= obj->memory[obj->parts].size;
+		}
 	}
 
 	vSpaceRelease(obj->vspace);
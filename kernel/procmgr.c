@@ -20,6 +20,7 @@
 #include <task.h>
 
 #include <scheduler.h>
+#include <rcu.h>
 
 /* Private types ------------------------------------------ */
 
@@ -248,11 +249,8 @@ void ProcProcessSafeClean(process_t *process)
 	// Update number of running processes
 	ProcMgr.runningProcs--;
 
-	// Free process handler
-	kfree(process, sizeof(*process));
-
-	// Invalidate ASID --> REMOVE FROM HEHRE!!!!
-	asm volatile ("mcr p15, 0, %0,c8, c3, 2" : : "r" (process->pid));
+	// Free process handler once lockless lookups can't be using it
+	RcuFree(process, sizeof(*process));
 }
 
 /**
@@ -290,13 +288,19 @@ void ProcProcessTerminate(process_t *process)
 */
 void ProcProcessKill(pid_t pid)
 {
+	// Only the lookup is lockless, from here the process is ours to release
+	RcuReadLock();
+
 	process_t *process = (process_t*)VectorPeek(&ProcMgr.processes, pid);
 
 	if(process == NULL || process == SchedGetRunningProcess())
 	{
+		RcuReadUnlock();
 		return;
 	}
 
+	RcuReadUnlock();
+
 	// Remove from parent
 	GlistRemoveSpecific(&process->siblings);
 
@@ -327,7 +331,7 @@ void ProcProcessKill(pid_t pid)
 	ProcessMemoryClean(process);
 
 	// Free process handler
-	kfree(process, sizeof(*process));
+	RcuFree(process, sizeof(*process));
 }
 
 int32_t ProcWaitPid(pid_t pid)
@@ -335,17 +339,23 @@ int32_t ProcWaitPid(pid_t pid)
 	task_t *task = SchedGetRunningTask();
 	process_t *process = task->parent;
 
+	// The child can exit meanwhile, read sections can't block
+	RcuReadLock();
+
 	// Is pid a child from process?
 	process_t *child = (process_t*)VectorPeek(&ProcMgr.processes, pid);
 
 	if((child == NULL) || (child->parent != process))
 	{
+		RcuReadUnlock();
 		return E_INVAL;
 	}
 
 	// TODO: Add to pending list (will be changed)
 	GlistInsertObject(&child->pendingTasks, &task->node);
 
+	RcuReadUnlock();
+
 	return SchedStopRunningTask(BLOCKED, SIGNAL_PENDING);
 
 //	return (int32_t)task->blocked.data;
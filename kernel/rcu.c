@@ -0,0 +1,215 @@
+/**
+ * @file        rcu.c
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        18 October, 2026
+ * @brief       Read-Copy-Update implementation
+*/
+
+/* Includes ----------------------------------------------- */
+#include <rcu.h>
+#include <arch.h>
+#include <klock.h>
+#include <kheap.h>
+#include <scheduler.h>
+
+
+/* Private types ------------------------------------------ */
+
+typedef struct
+{
+	rcu_head_t	head;
+	void		*ptr;
+	size_t		size;
+}rcu_free_t;
+
+
+/* Private constants -------------------------------------- */
+
+
+
+/* Private macros ----------------------------------------- */
+
+// Keeps the compiler from moving the lookups out of the read section
+#define barrier()			asm volatile("" : : : "memory")
+
+
+/* Private variables -------------------------------------- */
+
+static struct
+{
+	klock_t				lock;
+	uint32_t			online;		// Cpus taking part
+	volatile uint32_t	pending;	// Cpus that didn't pass a quiescent point yet, 0 when idle
+	rcu_head_t			*current;	// Waiting for the running grace period
+	rcu_head_t			*next;		// Queued while it runs, wait for the next one
+	rcu_head_t			*done;		// Ready to be called
+}rcu;
+
+
+/* Private function prototypes ---------------------------- */
+
+// Must be called with the lock taken
+static void RcuGraceStart()
+{
+	rcu.current = rcu.next;
+	rcu.next = NULL;
+	rcu.pending = ((rcu.current != NULL) ? (rcu.online) : (0));
+}
+
+static void RcuFreeCallback(rcu_head_t *head)
+{
+	rcu_free_t *record = (rcu_free_t*)head;
+
+	kfree(record->ptr, record->size);
+	kfree(record, sizeof(rcu_free_t));
+}
+
+
+/* Private functions -------------------------------------- */
+
+/**
+ * RcuInit Implementation (See header file for description)
+*/
+void RcuInit(uint32_t cpus)
+{
+	KlockInit(&rcu.lock);
+	KlockName(&rcu.lock, "rcu");
+
+	rcu.online = ((1UL << cpus) - 1);
+	rcu.pending = 0;
+	rcu.current = NULL;
+	rcu.next = NULL;
+	rcu.done = NULL;
+}
+
+/**
+ * RcuReadLock Implementation (See header file for description)
+*/
+void RcuReadLock(void)
+{
+	// Only the task changes its count, the scheduler reads it on the task cpu
+	SchedGetRunningTask()->rcuNest++;
+	barrier();
+}
+
+/**
+ * RcuReadUnlock Implementation (See header file for description)
+*/
+void RcuReadUnlock(void)
+{
+	barrier();
+	SchedGetRunningTask()->rcuNest--;
+}
+
+/**
+ * RcuCall Implementation (See header file for description)
+*/
+void RcuCall(rcu_head_t *head, void (*func)(rcu_head_t *head))
+{
+	head->func = func;
+
+	uint32_t status;
+	Klock(&rcu.lock, &status);
+
+	head->next = rcu.next;
+	rcu.next = head;
+
+	if(rcu.pending == 0)
+	{
+		RcuGraceStart();
+	}
+
+	Kunlock(&rcu.lock, &status);
+
+	// Callers are in task context, a good place to release older objects
+	RcuReclaim();
+}
+
+/**
+ * RcuFree Implementation (See header file for description)
+*/
+void RcuFree(void *ptr, size_t size)
+{
+	if(ptr == NULL)
+	{
+		return;
+	}
+
+	rcu_free_t *record = (rcu_free_t*)kmalloc(sizeof(rcu_free_t));
+
+	if(record == NULL)
+	{
+		// Leaked, freeing it now could pull it from under a reader
+		return;
+	}
+
+	record->ptr = ptr;
+	record->size = size;
+
+	RcuCall(&record->head, RcuFreeCallback);
+}
+
+/**
+ * RcuQuiescent Implementation (See header file for description)
+*/
+void RcuQuiescent(void)
+{
+	uint32_t mask = (1UL << RUNNING_CPU);
+
+	// Nothing to report, no lock taken
+	if(!(rcu.pending & mask))
+	{
+		return;
+	}
+
+	uint32_t status;
+	Klock(&rcu.lock, &status);
+
+	if(rcu.pending & mask)
+	{
+		rcu.pending &= ~mask;
+
+		if(rcu.pending == 0)
+		{
+			// Every cpu is done with the old objects
+			while(rcu.current != NULL)
+			{
+				rcu_head_t *head = rcu.current;
+				rcu.current = head->next;
+				head->next = rcu.done;
+				rcu.done = head;
+			}
+
+			RcuGraceStart();
+		}
+	}
+
+	Kunlock(&rcu.lock, &status);
+}
+
+/**
+ * RcuReclaim Implementation (See header file for description)
+*/
+void RcuReclaim(void)
+{
+	if(rcu.done == NULL)
+	{
+		return;
+	}
+
+	uint32_t status;
+	Klock(&rcu.lock, &status);
+
+	rcu_head_t *head = rcu.done;
+	rcu.done = NULL;
+
+	Kunlock(&rcu.lock, &status);
+
+	while(head != NULL)
+	{
+		rcu_head_t *next = head->next;
+		head->func(head);
+		head = next;
+	}
+}
@@ -10,6 +10,7 @@
 #include <rfs.h>
 #include <procmgr.h>
 #include <devices.h>
+#include <memmgr.h>
 
 
 /* Private types ------------------------------------------ */
@@ -244,3 +245,14 @@ int32_t RfsGet(vaddr_t *addr, size_t *size)
 	return E_OK;
 }
 
+bool_t RfsContains(paddr_t addr, size_t size)
+{
+	if(Rfs.hdr == NULL)
+	{
+		return FALSE;
+	}
+
+	uint32_t base = (uint32_t)MemoryL2P((ptr_t)Rfs.hdr);
+
+	return ((((uint32_t)addr) >= base) && ((((uint32_t)addr) + size) <= (base + Rfs.hdr->fs_size)));
+}
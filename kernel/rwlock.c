@@ -11,6 +11,7 @@
 #include <arch.h>
 #include <atomic.h>
 #include <spinlock.h>
+#include <asm.h>
 
 
 /* Private types ------------------------------------------ */
@@ -18,6 +19,7 @@
 
 
 /* Private constants -------------------------------------- */
+#define RWLOCK_WRITER       (1UL << 31)
 
 
 /* Private macros ----------------------------------------- */
@@ -26,10 +28,41 @@
 
 /* Private variables -------------------------------------- */
 
+// Read accesses held by each cpu and the interrupt status before the first
+static struct
+{
+    uint32_t depth;
+    uint32_t status;
+}readers[MAX_CPUS];
+
 
 
 /* Private function prototypes ---------------------------- */
 
+// Interrupts stay disabled from the first read access of the cpu to the last
+static uint32_t ReadEnter()
+{
+    uint32_t status;
+
+    critical_lock(&status);
+
+    uint32_t cpu = _cpuId();
+
+    if(readers[cpu].depth++ == 0)
+    {
+        readers[cpu].status = status;
+    }
+
+    return cpu;
+}
+
+static void ReadLeave(uint32_t cpu)
+{
+    if(--readers[cpu].depth == 0)
+    {
+        critical_unlock(&readers[cpu].status);
+    }
+}
 
 
 /* Private functions -------------------------------------- */
@@ -39,7 +72,7 @@
 */
 void RWlockInit(rwlock_t* lock)
 {
-    lock->readers = 0;
+    lock->state = 0;
     lock->writer = NO_WRITER;
 }
 
@@ -48,12 +81,26 @@ void RWlockInit(rwlock_t* lock)
 */
 void ReadLock(rwlock_t* lock)
 {
-    atomic_inc(&lock->readers);
+    volatile uint32_t* state = &lock->state;
+    uint32_t cpu = ReadEnter();
 
-    while(atomic_cmp_set(&lock->writer, NO_WRITER, NO_WRITER) != E_OK)
+    while(TRUE)
     {
-        _cpu_hold();
+        uint32_t value = *state;
+
+        // Readers already in keep the writer out, nested reads can't deadlock
+        if((!(value & RWLOCK_WRITER) || (lock->writer == cpu)) && (atomic_cmp_set(&lock->state, value, value + 1) == E_OK))
+        {
+            break;
+        }
+
+        if(value & RWLOCK_WRITER)
+        {
+            _cpu_hold();
+        }
     }
+
+    dmb();
 }
 
 /**
@@ -61,9 +108,15 @@ void ReadLock(rwlock_t* lock)
 */
 void ReadUnlock(rwlock_t* lock)
 {
-    atomic_dec(&lock->readers);
+    dmb();
 
-    _cpus_signal();
+    // Only a writer can be waiting and only for the last reader
+    if(atomic_dec((int32_t*)&lock->state) == 0)
+    {
+        _cpus_signal();
+    }
+
+    ReadLeave(_cpuId());
 }
 
 /**
@@ -73,10 +126,14 @@ void WriteLock(rwlock_t* lock, uint32_t* status)
 {
     critical_lock(status);
 
-    while(lock->readers > 0 && atomic_cmp_set(&lock->writer, NO_WRITER, _cpuId()) != E_OK)
+    while(atomic_cmp_set(&lock->state, 0, RWLOCK_WRITER) != E_OK)
     {
         _cpu_hold();
     }
+
+    lock->writer = _cpuId();
+
+    dmb();
 }
 
 /**
@@ -84,15 +141,128 @@ void WriteLock(rwlock_t* lock, uint32_t* status)
 */
 void WriteUnlock(rwlock_t* lock, uint32_t* status)
 {
-    if(atomic_cmp_set(&lock->writer, _cpuId(), NO_WRITER) != E_OK)
+    dmb();
+
+    lock->writer = NO_WRITER;
+    lock->state = 0;
+
+    _cpus_signal();
+
+    critical_unlock(status);
+}
+
+/**
+ * BrlockInit Implementation (See header file for description)
+*/
+void BrlockInit(brlock_t* lock)
+{
+    uint32_t cpu;
+
+    for(cpu = 0; cpu < MAX_CPUS; cpu++)
+    {
+        lock->cpu[cpu].readers = 0;
+    }
+
+    lock->writer = NO_WRITER;
+}
+
+/**
+ * BrReadLock Implementation (See header file for description)
+*/
+void BrReadLock(brlock_t* lock)
+{
+    volatile uint32_t* writer = &lock->writer;
+    int32_t* readers = &lock->cpu[ReadEnter()].readers;
+
+    while(TRUE)
+    {
+        while(*writer != NO_WRITER)
+        {
+            _cpu_hold();
+        }
+
+        (void)atomic_inc(readers);
+
+        // Either the writer sees us or we see the writer
+        dmb();
+
+        if(*writer == NO_WRITER)
+        {
+            return;
+        }
+
+        // Writer got in meanwhile, let it go first
+        (void)atomic_dec(readers);
+
+        _cpus_signal();
+    }
+}
+
+/**
+ * BrReadUnlock Implementation (See header file for description)
+*/
+void BrReadUnlock(brlock_t* lock)
+{
+    dmb();
+
+    uint32_t cpu = _cpuId();
+
+    (void)atomic_dec(&lock->cpu[cpu].readers);
+
+    if(*((volatile uint32_t*)&lock->writer) != NO_WRITER)
+    {
+        _cpus_signal();
+    }
+
+    ReadLeave(cpu);
+}
+
+/**
+ * BrWriteLock Implementation (See header file for description)
+*/
+void BrWriteLock(brlock_t* lock, uint32_t* status)
+{
+    critical_lock(status);
+
+    while(atomic_cmp_set(&lock->writer, NO_WRITER, _cpuId()) != E_OK)
     {
-        // We are not the owners :O
-    	_cpus_signal();
+        _cpu_hold();
     }
-    else
+
+    // Either the readers see us or we see them
+    dmb();
+
+    while(TRUE)
     {
-    	_cpus_signal();
+        int32_t readers = 0;
+        uint32_t cpu;
+
+        for(cpu = 0; cpu < MAX_CPUS; cpu++)
+        {
+            readers += *((volatile int32_t*)&lock->cpu[cpu].readers);
+        }
 
-    	critical_unlock(status);
+        if(readers == 0)
+        {
+            break;
+        }
+
+        _cpu_hold();
     }
+
+    dmb();
+}
+
+/**
+ * BrWriteUnlock Implementation (See header file for description)
+*/
+void BrWriteUnlock(brlock_t* lock, uint32_t* status)
+{
+    dmb();
+
+    lock->writer = NO_WRITER;
+
+    _cpus_signal();
+
+    critical_unlock(status);
 }
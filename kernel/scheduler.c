@@ -18,9 +18,13 @@
 #include <isr.h>
 #include <board.h>
 #include <klock.h>
+#include <pmu.h>
 
 #include <sleep.h>
 #include <systimer.h>
+#include <latency.h>
+#include <rcu.h>
+#include <hrtimer.h>
 
 /* Private types ------------------------------------------ */
 typedef struct
@@ -32,6 +36,13 @@ typedef struct
     uint32_t   tslice;
     task_t*    task;
     process_t* process;
+    uint32_t   tlbSample;
+    uint32_t   tlbRefills;
+    process_t* vspace;       // Process translations loaded in the MMU
+    uint32_t   vsAsid;       // And the hardware ASID they were loaded with
+    uint32_t   vsSwitches;
+    uint32_t   vsSkips;
+    uint64_t   vsCycles;
 }cpu_t;
 
 typedef struct
@@ -120,7 +131,13 @@ uint16_t SchedPendingPrio()
 
 task_t* SchedGetNext2Run()
 {
-    return GLISTNODE2TYPE(GlistRemoveFirst(&sched.tasks), task_t, node);
+    task_t* task = GLISTNODE2TYPE(GlistRemoveFirst(&sched.tasks), task_t, node);
+
+#ifdef IRQ_LATENCY
+    LatencyTaskRun(task);
+#endif
+
+    return task;
 }
 
 void SchedHoldTask(task_t* task)
@@ -170,6 +187,13 @@ int32_t SchedulerInit(uint32_t schedHz)
         CPUS[i].tslice = 0;
         CPUS[i].task = NULL;
         CPUS[i].process = NULL;
+        CPUS[i].tlbSample = 0;
+        CPUS[i].tlbRefills = 0;
+        CPUS[i].vspace = NULL;
+        CPUS[i].vsAsid = 0;
+        CPUS[i].vsSwitches = 0;
+        CPUS[i].vsSkips = 0;
+        CPUS[i].vsCycles = 0;
     }
 
     sched.lprio = 0xFFFF;
@@ -179,6 +203,7 @@ int32_t SchedulerInit(uint32_t schedHz)
     SchedListInit();
 
     KlockInit(&sched.lock);
+    KlockName(&sched.lock, "sched");
     SchedLock(NULL);
 
     // At this point it should be safe to resume the other cores since they will block when trying to get a task
@@ -206,8 +231,14 @@ void SchedulerStart()
     // Install Scheduler interrupt
     InterruptAttach(SCHEDULER_IRQ, 10, Schedule, NULL);
 
+    // Each cpu takes the high resolution timers started on it
+    HrtimerCpuStart();
+
     cpu_t* cpu = &CPUS[RUNNING_CPU];
 
+    // Each cpu has its own PMU, counters start from zero
+    PmuInit();
+
     if(cpu->id == 0)
     {
     	SystemTickStart(sched.tslice, SystemTick);
@@ -225,14 +256,7 @@ void SchedulerStart()
 
     _TaskSetTls(cpu->task->memory.tls);
 
-    if(cpu->process != NULL)
-    {
-        _VirtualSpaceSet(
-            NULL,
-            (pgt_t)MemoryL2P((ptr_t)cpu->process->Memory.pgt),
-            cpu->process->pid
-        );
-    }
+    SchedVirtualSpaceSet(cpu->process);
 
     if(cpu->process) atomic_inc(&cpu->process->tasksRunning);
 
@@ -256,17 +280,41 @@ void* SchedIrqAttend()
 
 void* SchedIrqExit()
 {
-    return ((--CPUS[RUNNING_CPU].irqlevel) ? (NULL) : (CPUS[RUNNING_CPU].task->memory.registers));
+    cpu_t* cpu = &CPUS[RUNNING_CPU];
+
+    if(--cpu->irqlevel)
+    {
+        return NULL;
+    }
+
+    // Interrupts never run in a process context, the translations only change
+    // here when the interrupt scheduled a task of another process
+    SchedVirtualSpaceSet(cpu->process);
+
+    return cpu->task->memory.registers;
 }
 
 void* Schedule(void *arg, uint32_t irq)
 {
 	(void)arg; (void)irq;
 
+    cpu_t* cpu = &CPUS[RUNNING_CPU];
+
+    // Not nested in another handler and the task isn't reading, nothing on
+    // this cpu can still hold an object unlinked before
+    if((cpu->irqlevel == 1) && (cpu->task->rcuNest == 0))
+    {
+        RcuQuiescent();
+        RcuReclaim();
+    }
+
     uint32_t state;
     SchedLock(&state);
 
-    cpu_t* cpu = &CPUS[RUNNING_CPU];
+    // Account the TLB refills taken since the last schedule on this cpu
+    uint32_t refills = PmuCounterRead(PMU_COUNTER_DTLB) + PmuCounterRead(PMU_COUNTER_ITLB);
+    cpu->tlbRefills += (refills - cpu->tlbSample);
+    cpu->tlbSample = refills;
 
     if(cpu->task->state == DEAD)
     {
@@ -288,6 +336,15 @@ void* Schedule(void *arg, uint32_t irq)
 		    return NULL;
 		}
 
+		if(cpu->task->rcuNest != 0)
+		{
+			// Read sections are short, try again on the next tick
+			cpu->tslice = 1;
+		    SchedUnlock(&state);
+
+		    return NULL;
+		}
+
 		// Put running task on ready list
 		if(cpu->process) atomic_dec(&cpu->process->tasksRunning);
 
@@ -313,6 +370,101 @@ void* Schedule(void *arg, uint32_t irq)
 }
 
 
+/**
+ * SchedVirtualSpaceSet Implementation (See header file for description)
+*/
+void SchedVirtualSpaceSet(process_t* process)
+{
+	if(process == NULL)
+	{
+		// Kernel tasks run on any user translations
+		return;
+	}
+
+	uint32_t state;
+	critical_lock(&state);
+
+	cpu_t* cpu = &CPUS[RUNNING_CPU];
+
+	uint32_t start = PmuCyclesRead();
+
+	// Also on a skip, a rollover can have given the process another ASID and the
+	// cpu has to invalidate its TLB before it runs with the new generation
+	uint32_t asid = AsidGet(&process->Memory.asid);
+
+	if((cpu->vspace == process) && (cpu->vsAsid == asid))
+	{
+		cpu->vsSkips++;
+	}
+	else
+	{
+		_VirtualSpaceSet(
+			NULL,
+			(pgt_t)MemoryL2P((ptr_t)process->Memory.pgt),
+			asid
+		);
+
+		cpu->vsCycles += (PmuCyclesRead() - start);
+		cpu->vsSwitches++;
+		cpu->vspace = process;
+		cpu->vsAsid = asid;
+	}
+
+	critical_unlock(&state);
+}
+
+/**
+ * SchedVirtualSpaceDrop Implementation (See header file for description)
+*/
+void SchedVirtualSpaceDrop(process_t* process)
+{
+	uint32_t i;
+
+	for(i = 0; i < sched.cpus; i++)
+	{
+		if(CPUS[i].vspace == process)
+		{
+			CPUS[i].vspace = NULL;
+		}
+	}
+}
+
+/**
+ * SchedGetSwitchStats Implementation (See header file for description)
+*/
+void SchedGetSwitchStats(uint32_t* switches, uint32_t* skips, uint32_t* cycles)
+{
+	uint64_t total = 0;
+	uint32_t i;
+
+	*switches = *skips = 0;
+
+	for(i = 0; i < sched.cpus; i++)
+	{
+		*switches += CPUS[i].vsSwitches;
+		*skips += CPUS[i].vsSkips;
+		total += CPUS[i].vsCycles;
+	}
+
+	*cycles = ((*switches) ? ((uint32_t)(total / *switches)) : (0));
+}
+
+/**
+ * SchedGetTlbRefills Implementation (See header file for description)
+*/
+uint32_t SchedGetTlbRefills()
+{
+	uint32_t refills = 0;
+	uint32_t i;
+
+	for(i = 0; i < sched.cpus; i++)
+	{
+		refills += CPUS[i].tlbRefills;
+	}
+
+	return refills;
+}
+
 /**
  * SchedGetRunningTask Implementation (See header file for description)
 */
@@ -380,7 +532,6 @@ void* SchedTerminateRunningTask(bool_t proc_death)
 	SchedEnsureLock(NULL);
 
 	cpu_t* cpu = &CPUS[RUNNING_CPU];
-	process_t* process = cpu->process;
 
 	if(proc_death != TRUE && cpu->process) atomic_dec(&cpu->process->tasksRunning);
 
@@ -398,15 +549,8 @@ void* SchedTerminateRunningTask(bool_t proc_death)
 
 	_TaskSetTls(cpu->task->memory.tls);
 
-	if(cpu->process != NULL && (process == NULL || cpu->process != process))
-	{
-		// Change process virtual space
-		_VirtualSpaceSet(
-			NULL,
-			(pgt_t)MemoryL2P((ptr_t)cpu->process->Memory.pgt),
-			cpu->process->pid
-		);
-	}
+	// Change process virtual space
+	SchedVirtualSpaceSet(cpu->process);
 
 	if(cpu->process) atomic_inc(&cpu->process->tasksRunning);
 
@@ -436,6 +580,12 @@ int32_t SchedStopRunningTask(uint8_t state, uint8_t substate)
 	// Clean task return
 	task->ret = 0;
 
+	// Blocking from a task, outside a read section by contract
+	if(cpu->irqlevel == 0)
+	{
+		RcuQuiescent();
+	}
+
 	_TaskSave(task->memory.registers);
 
 	if(resume)
@@ -467,14 +617,9 @@ int32_t SchedStopRunningTask(uint8_t state, uint8_t substate)
     // Only signal the stop now to avoid problems when the process is terminating
     if(prev_process) atomic_dec(&prev_process->tasksRunning);
 
-    if(cpu->process != NULL)
-    {
-    	_SchedResumeTask(cpu->task->memory.registers, (pgt_t)MemoryL2P((ptr_t)cpu->process->Memory.pgt), cpu->process->pid);
-    }
-    else
-    {
-    	_SchedResumeTask(cpu->task->memory.registers, NULL, 0);
-    }
+    SchedVirtualSpaceSet(cpu->process);
+
+    _SchedResumeTask(cpu->task->memory.registers, NULL, 0);
 
     // Will not return
     return 0;
@@ -483,6 +628,10 @@ int32_t SchedStopRunningTask(uint8_t state, uint8_t substate)
 
 void SchedAddTask(task_t* task)
 {
+#ifdef IRQ_LATENCY
+    LatencyTaskWakeup(task);
+#endif
+
     uint32_t state;
     SchedLock(&state);
 
@@ -530,6 +679,11 @@ void* SystemTick(void* arg, uint32_t intr)
     // Send tick to all sleeping tasks
     SleepUpdate();
 
+#ifdef INTERRUPT_BALANCER
+    // Move busy interrupts away from loaded cpus
+    InterruptBalance();
+#endif
+
     // Lock scheduler to ensure that time slices are not corrupted
     uint32_t state;
     SchedLock(&state);
@@ -12,6 +12,11 @@
 #include <kheap.h>
 #include <atomic.h>
 #include <sleep.h>
+#include <process.h>
+#include <klock.h>
+#include <rwlock.h>
+#include <asm.h>
+#include <rcu.h>
 
 
 /* Private types ------------------------------------------ */
@@ -20,14 +25,17 @@
 /* Private constants -------------------------------------- */
 #define SEM_MAGIC			(0xAAAADEAD)
 
+// Semaphore words hash to a lock, the same word always uses the same lock
+#define SEM_WORD_LOCKS		(16)
 
-/* Private macros ----------------------------------------- */
 
+/* Private macros ----------------------------------------- */
+#define SEM_WORD_LOCK(word)		(&wordLocks[((uint32_t)(word) >> 2) & (SEM_WORD_LOCKS - 1)])
 
 
 /* Private variables -------------------------------------- */
 
-
+static klock_t wordLocks[SEM_WORD_LOCKS];
 
 /* Private function prototypes ---------------------------- */
 
@@ -89,6 +97,82 @@ void SemResumeTimeout(void* semaphore, task_t* task)
 	SchedAddTask(task);
 }
 
+/*
+ * Wait queue of a user semaphore word, has to be called with the word lock taken
+ */
+static sem_t *SemWordQueue(process_t *process, uint32_t *word, bool_t create)
+{
+	sem_t *sem;
+
+	ReadLock(&process->semaphores.lock);
+
+	for(sem = GLIST_FIRST(&process->semaphores, sem_t, node); sem != NULL; sem = GLIST_NEXT(&sem->node, sem_t, node))
+	{
+		if(sem->word == word)
+		{
+			break;
+		}
+	}
+
+	ReadUnlock(&process->semaphores.lock);
+
+	if((sem != NULL) || (create == FALSE))
+	{
+		return sem;
+	}
+
+	sem = (sem_t*)kmalloc(sizeof(sem_t));
+
+	if(sem == NULL)
+	{
+		return NULL;
+	}
+
+	sem->magic = SEM_MAGIC;
+	sem->counter = 0;
+	sem->word = word;
+	spinlock_init(&sem->spinLock);
+
+	GlistInitialize(&sem->lockQueue, GList);
+	GlistSetSort(&sem->lockQueue, ReadyListSort);
+
+	GlistInsertObject(&process->semaphores, &sem->node);
+
+	return sem;
+}
+
+static void SemWordRelease(sem_t *sem)
+{
+	GlistRemoveSpecific(&sem->node);
+	// A timeout handler that lost the race can still be looking at it
+	RcuFree(sem, sizeof(*sem));
+}
+
+void SemWordResumeTimeout(void* semaphore, task_t* task)
+{
+	sem_t* sem = (sem_t*)semaphore;
+	klock_t* lock = SEM_WORD_LOCK(sem->word);
+
+	uint32_t state;
+	Klock(lock, &state);
+
+	// Once posted the task can already be waiting on something else
+	if((task->node.owner != (void*)&sem->lockQueue) || (GlistRemoveSpecific(&task->node) != E_OK))
+	{
+		// A post gave us a unit before the timeout
+		Kunlock(lock, &state);
+
+		return;
+	}
+
+	// The waiters flag stays set, the next post finds an empty queue and clears it
+	task->ret = E_TIMED_OUT;
+
+	Kunlock(lock, &state);
+
+	SchedAddTask(task);
+}
+
 /* Private functions -------------------------------------- */
 
 sem_t *SemCreate(uint32_t value)
@@ -97,6 +181,7 @@ sem_t *SemCreate(uint32_t value)
 
 	sem->magic   = SEM_MAGIC;
 	sem->counter = (int32_t)value;
+	sem->word    = NULL;
 	spinlock_init(&sem->spinLock);
 
 	GlistInitialize(&sem->lockQueue, GList);
@@ -223,3 +308,159 @@ int32_t SemDestroy(sem_t *sem)
 
 	return E_OK;
 }
+
+void SemWordInit(void)
+{
+	uint32_t i;
+
+	for(i = 0; i < SEM_WORD_LOCKS; i++)
+	{
+		KlockInit(&wordLocks[i]);
+		KlockName(&wordLocks[i], "semWord");
+	}
+}
+
+int32_t SemWordWait(uint32_t *word)
+{
+	process_t *process = SchedGetRunningProcess();
+
+	// The count is read and changed from the kernel
+	if(!ProcessUserWordValid(process, word))
+	{
+		return E_INVAL;
+	}
+
+	task_t *task = SchedGetRunningTask();
+	klock_t *lock = SEM_WORD_LOCK(word);
+
+	uint32_t state;
+	Klock(lock, &state);
+
+	while(TRUE)
+	{
+		uint32_t value = *word;
+
+		if(value & SEM_WORD_COUNT_MASK)
+		{
+			// Posted before we got here
+			if(atomic_cmp_set(word, value, value - 1) == E_OK)
+			{
+				Kunlock(lock, &state);
+
+				return E_OK;
+			}
+
+			continue;
+		}
+
+		// Posts in user space will fail from now on
+		if((value & SEM_WORD_WAITERS) || (atomic_cmp_set(word, value, value | SEM_WORD_WAITERS) == E_OK))
+		{
+			break;
+		}
+	}
+
+	sem_t *sem = SemWordQueue(process, word, TRUE);
+
+	if(sem == NULL)
+	{
+		Kunlock(lock, &state);
+
+		return E_NO_MEMORY;
+	}
+
+	GlistInsertObject(&sem->lockQueue, &task->node);
+
+	if(task->timeout.set == TRUE)
+	{
+		TimerSet(task, SemWordResumeTimeout, sem);
+	}
+
+	// Lock scheduler to suspend task
+	SchedLock(NULL);
+
+	Kunlock(lock, NULL);
+
+	int32_t ret = SchedStopRunningTask(BLOCKED, SEMAPHORE);
+
+	// We still have interrupts disable for this task so we have to enable them
+	critical_unlock(&state);
+
+	return ret;
+}
+
+int32_t SemWordPost(uint32_t *word)
+{
+	process_t *process = SchedGetRunningProcess();
+
+	if(!ProcessUserWordValid(process, word))
+	{
+		return E_INVAL;
+	}
+
+	klock_t *lock = SEM_WORD_LOCK(word);
+
+	uint32_t state;
+	Klock(lock, &state);
+
+	sem_t *sem = SemWordQueue(process, word, FALSE);
+	task_t *next = NULL;
+
+	if(sem != NULL)
+	{
+		next = GLISTNODE2TYPE(GlistRemoveFirst(&sem->lockQueue), task_t, node);
+	}
+
+	if(next != NULL)
+	{
+		// The timeout can't run once the queue may be released
+		if(next->timeout.set == TRUE)
+		{
+			TimerStop(next);
+		}
+
+		next->ret = E_OK;
+
+		if(GLIST_EMPTY(&sem->lockQueue))
+		{
+			// With the waiters flag set the count is only changed by the kernel
+			*word = (*word & SEM_WORD_COUNT_MASK);
+			dmb();
+
+			SemWordRelease(sem);
+		}
+	}
+	else
+	{
+		uint32_t value;
+
+		do
+		{
+			value = *word;
+
+			if((value & SEM_WORD_COUNT_MASK) == SEM_WORD_COUNT_MASK)
+			{
+				Kunlock(lock, &state);
+
+				return E_NO_RES;
+			}
+		}
+		// Waiters timed out, clear the flag so posts stay in user space
+		while(atomic_cmp_set(word, value, (value & SEM_WORD_COUNT_MASK) + 1) != E_OK);
+
+		if(sem != NULL)
+		{
+			SemWordRelease(sem);
+		}
+	}
+
+	Kunlock(lock, &state);
+
+	if(next != NULL)
+	{
+		// Preempts a lower priority cpu if needed
+		SchedAddTask(next);
+	}
+
+	return E_OK;
+}
@@ -11,63 +11,117 @@
 #include <glist.h>
 #include <scheduler.h>
 #include <sleep.h>
+#include <klock.h>
+#include <spinlock.h>
+#include <hrtimer.h>
+#include <process.h>
 
 /* Private types ------------------------------------------ */
 
 
 /* Private constants -------------------------------------- */
 
+// Hierarchical timer wheel, each level slot spans a full turn of the level below
+#define WHEEL_LEVELS		(4)
+#define WHEEL_BITS			(6)
+#define WHEEL_SLOTS			(1UL << WHEEL_BITS)
+#define WHEEL_MASK			(WHEEL_SLOTS - 1)
+
+// Longer timeouts wait at the end of the wheel and are inserted again from there
+#define WHEEL_RANGE			(1UL << (WHEEL_LEVELS * WHEEL_BITS))
 
 
 /* Private macros ----------------------------------------- */
 
+#define WHEEL_INDEX(ticks, level)	(((ticks) >> ((level) * WHEEL_BITS)) & WHEEL_MASK)
 
 
 /* Private variables -------------------------------------- */
 
 struct
 {
-	glist_t	list;
+	klock_t		lock;
+	uint32_t	now;		// Last tick handled
+	glist_t		wheel[WHEEL_LEVELS][WHEEL_SLOTS];
 }Sleep_Handler;
 
 
 /* Private function prototypes ---------------------------- */
 
-int32_t SleepStort(glistNode_t *current, glistNode_t *task)
+/*
+ * Insert the task timer in the slot that expires or cascades next before its
+ * wake up tick (timeout.pendTime). Cascades run before the current tick slot
+ * is handled, there a due timer goes to that slot. A new timer already due is
+ * handled on the next tick. Must be called with the lock taken
+ */
+static void SleepWheelInsert(task_t *task, bool_t cascade)
 {
-    task_t *c = GLISTNODE2TYPE(current, task_t, timeout.node);
-    task_t *t = GLISTNODE2TYPE(task, task_t, timeout.node);
-
-    if(t->timeout.pendTime >= c->timeout.pendTime)
-    {
-        t->timeout.pendTime -= c->timeout.pendTime;
-        return 1;
-    }
-    else
-    {
-        c->timeout.pendTime -= t->timeout.pendTime;
-        return 0;
-    }
+	uint32_t delta = task->timeout.pendTime - Sleep_Handler.now;
+	uint32_t expires = task->timeout.pendTime;
+	uint32_t level;
+
+	if((delta == 0) && !cascade)
+	{
+		delta = 1;
+		expires = Sleep_Handler.now + 1;
+	}
+
+	if(delta >= WHEEL_RANGE)
+	{
+		delta = WHEEL_RANGE - 1;
+		expires = Sleep_Handler.now + delta;
+	}
+
+	for(level = 0; level < (WHEEL_LEVELS - 1); level++)
+	{
+		if(delta < (1UL << ((level + 1) * WHEEL_BITS)))
+		{
+			break;
+		}
+	}
+
+	GlistInsertObject(&Sleep_Handler.wheel[level][WHEEL_INDEX(expires, level)], &task->timeout.node);
 }
 
-int32_t SleepMatch(glistNode_t *gnode, void *id)
+/*
+ * A level turned, spread the slot timers over the levels below. Returns
+ * TRUE when this level also turned. Must be called with the lock taken
+ */
+static bool_t SleepWheelCascade(uint32_t level)
 {
-    task_t *task = GLISTNODE2TYPE(gnode, task_t, timeout.node);
-
-    if(task->tid == (uint32_t)id)
-    {
-        task_t *tnext = GLIST_NEXT(&task->timeout.node, task_t, timeout.node);
-
-        if(tnext)
-        {
-            tnext->timeout.pendTime += task->timeout.pendTime;
-        }
-        return 0;
-    }
-    else
-    {
-        return 1;
-    }
+	uint32_t index = WHEEL_INDEX(Sleep_Handler.now, level);
+	glist_t *slot = &Sleep_Handler.wheel[level][index];
+	glistNode_t *node;
+
+	while((node = GlistRemoveFirst(slot)) != NULL)
+	{
+		SleepWheelInsert(GLISTNODE2TYPE(node, task_t, timeout.node), TRUE);
+	}
+
+	return (index == 0);
+}
+
+// The timer went off, must be called without the lock
+static void SleepExpired(task_t *task)
+{
+	// A handler means it was a time out, otherwise the task was sleeping
+	if(task->timeout.handler != NULL)
+	{
+		task->timeout.handler(task->timeout.arg, task);
+		if(!(task->timeout.type & TIMER_AUTO_RELOAD))
+		{
+			task->timeout.set = FALSE;
+		}
+	}
+	else
+	{
+		SchedAddTask(task);
+	}
+}
+
+static void SleepHrtimerExpired(hrtimer_t *timer)
+{
+	SleepExpired(GLISTNODE2TYPE(&timer->node, task_t, timeout.hrtimer.node));
 }
 
 
@@ -76,9 +130,21 @@ int32_t SleepMatch(glistNode_t *gnode, void *id)
 
 uint32_t SleepInit()
 {
-	GlistInitialize(&Sleep_Handler.list, GList);
-	(void)GlistSetSort(&Sleep_Handler.list, SleepStort);
-	(void)GlistSetCmp(&Sleep_Handler.list, SleepMatch);
+	uint32_t level, slot;
+
+	KlockInit(&Sleep_Handler.lock);
+	KlockName(&Sleep_Handler.lock, "sleep");
+
+	Sleep_Handler.now = 0;
+
+	for(level = 0; level < WHEEL_LEVELS; level++)
+	{
+		for(slot = 0; slot < WHEEL_SLOTS; slot++)
+		{
+			GlistInitialize(&Sleep_Handler.wheel[level][slot], GFifo);
+		}
+	}
+
 	return E_OK;
 }
 
@@ -87,10 +153,20 @@ uint32_t SleepInit()
 void SleepInsert(uint32_t time)
 {
 	task_t *task = SchedGetRunningTask();
-//	task->info.subState = SLEEPING;
-	task->timeout.pendTime = time;
-	GlistInsertObject(&Sleep_Handler.list, &task->timeout.node);
+
+	uint32_t status;
+	Klock(&Sleep_Handler.lock, &status);
+
+	// No handler, it is woken up when the time is over
+	task->timeout.handler = NULL;
+	task->timeout.pendTime = Sleep_Handler.now + time;
+	SleepWheelInsert(task, FALSE);
+
+	// The tick can't wake us up before we are stopped
+	SchedLock(NULL);
+	Kunlock(&Sleep_Handler.lock, NULL);
 	SchedStopRunningTask(BLOCKED, SLEEPING);
+	critical_unlock(&status);
 }
 
 void TimeoutSet(uint32_t time, int32_t type)
@@ -98,7 +174,7 @@ void TimeoutSet(uint32_t time, int32_t type)
 	task_t* task = SchedGetRunningTask();
 	task->timeout.waitTime = time;
 	task->timeout.set = TRUE;
-	task->timeout.type = ((type == TIMER_AUTO_RELOAD) ? (TIMER_AUTO_RELOAD) : (TIMER_NO_RELOAD));
+	task->timeout.type = (type & (TIMER_AUTO_RELOAD | TIMER_HIGH_RES));
 }
 
 void TimeoutUnset()
@@ -113,14 +189,30 @@ void TimerSet(task_t* task, void (*handler)(void*,task_t*), void* arg)
 {
 	task->timeout.handler = handler;
 	task->timeout.arg = arg;
-	task->timeout.pendTime = task->timeout.waitTime;
-	GlistInsertObject(&Sleep_Handler.list, &task->timeout.node);
+
+	if(task->timeout.type & TIMER_HIGH_RES)
+	{
+		timespec_t time;
+		time.sec = (task->timeout.waitTime / 1000000);
+		time.nsec = (task->timeout.waitTime % 1000000) * 1000;
+
+		(void)HrtimerStart(&task->timeout.hrtimer, &time, HRTIMER_REL, SleepHrtimerExpired);
+		return;
+	}
+
+	uint32_t status;
+	Klock(&Sleep_Handler.lock, &status);
+
+	task->timeout.pendTime = Sleep_Handler.now + task->timeout.waitTime;
+	SleepWheelInsert(task, FALSE);
+
+	Kunlock(&Sleep_Handler.lock, &status);
 }
 
 void TimerStop(task_t* task)
 {
 	SleepRemove(task);
-	if(task->timeout.type == TIMER_NO_RELOAD)
+	if(!(task->timeout.type & TIMER_AUTO_RELOAD))
 	{
 		task->timeout.waitTime = 0;
 		task->timeout.set = FALSE;
@@ -129,44 +221,77 @@ void TimerStop(task_t* task)
 
 void SleepRemove(task_t *task)
 {
-    task_t *tnext = GLIST_NEXT(&task->timeout.node, task_t, timeout.node);
-    GlistRemoveSpecific(&task->timeout.node);
-    if(tnext)
-    {
-        tnext->timeout.pendTime += task->timeout.pendTime;
-    }
+	uint32_t status;
+	Klock(&Sleep_Handler.lock, &status);
+
+	// Cascades move timers between slots, only safe to remove with the lock
+	GlistRemoveSpecific(&task->timeout.node);
+
+	Kunlock(&Sleep_Handler.lock, &status);
+
+	(void)HrtimerCancel(&task->timeout.hrtimer);
 }
 
 void SleepUpdate()
 {
-    task_t *task = GLIST_FIRST(&Sleep_Handler.list, task_t, timeout.node);
-    if(task)
-    {
-        task->timeout.pendTime--;
-    }
-    else
-    {
-        return;
-    }
-
-    while(task && !task->timeout.pendTime)
-    {
-    	GlistRemoveSpecific(&task->timeout.node);
-
-    	// If sub state was not Sleeping it was a time out so we need to call the timeout handler
-    	if(task->subState != SLEEPING)
-    	{
-    		task->timeout.handler(task->timeout.arg, task);
-    		if(task->timeout.type == TIMER_NO_RELOAD)
-    		{
-    			task->timeout.set = FALSE;
-    		}
-    	}
-    	else
-    	{
-    		SchedAddTask(task);
-    	}
-
-        task = GLIST_FIRST(&Sleep_Handler.list, task_t, timeout.node);
-    }
+	uint32_t status;
+	Klock(&Sleep_Handler.lock, &status);
+
+	uint32_t level = 1;
+	glist_t *slot = &Sleep_Handler.wheel[0][WHEEL_INDEX(++Sleep_Handler.now, 0)];
+
+	// Each upper level slot is only handled once the level below turns
+	if(WHEEL_INDEX(Sleep_Handler.now, 0) == 0)
+	{
+		while((level < WHEEL_LEVELS) && SleepWheelCascade(level))
+		{
+			level++;
+		}
+	}
+
+	glistNode_t *node;
+
+	while((node = GlistRemoveFirst(slot)) != NULL)
+	{
+		task_t *task = GLISTNODE2TYPE(node, task_t, timeout.node);
+
+		// Handlers take their objects locks, those are held while timers are stopped
+		Kunlock(&Sleep_Handler.lock, NULL);
+		SleepExpired(task);
+		Klock(&Sleep_Handler.lock, NULL);
+	}
+
+	Kunlock(&Sleep_Handler.lock, &status);
+}
+
+int32_t NanoSleep(const timespec_t *time, uint32_t mode)
+{
+	process_t *process = SchedGetRunningProcess();
+
+	// Both words, the timespec can cross a page boundary
+	if((mode > HRTIMER_ABS) || !ProcessUserWordReadable(process, &time->sec)
+		|| !ProcessUserWordReadable(process, &time->nsec))
+	{
+		return E_INVAL;
+	}
+
+	// Copied before the interrupts are disabled
+	timespec_t deadline = *time;
+
+	if(deadline.nsec >= HRTIMER_NSEC_PER_SEC)
+	{
+		return E_INVAL;
+	}
+
+	task_t *task = SchedGetRunningTask();
+	task->timeout.handler = NULL;
+
+	// The deadline interrupt goes to this cpu, it can't come before we are stopped
+	uint32_t status;
+	SchedLock(&status);
+	(void)HrtimerStart(&task->timeout.hrtimer, &deadline, mode, SleepHrtimerExpired);
+	SchedStopRunningTask(BLOCKED, SLEEPING);
+	critical_unlock(&status);
+
+	return E_OK;
 }
@@ -17,6 +17,11 @@
 #include <misc.h>
 #include <kheap.h>
 #include <rwlock.h>
+#include <latency.h>
+#include <mutex.h>
+#include <klock.h>
+#include <hrtimer.h>
+#include <rcu.h>
 
 
 /* Private types ------------------------------------------ */
@@ -53,7 +58,7 @@ typedef struct
 static struct
 {
     namespace_t root;
-    rwlock_t	lock;
+    brlock_t	lock;
 }System;
 
 /* Private function prototypes ---------------------------- */
@@ -225,7 +230,7 @@ void ServerRemove(server_t *server)
 void SystemInit()
 {
     memset(&System.root, 0x0, sizeof(namespace_t));
-    RWlockInit(&System.lock);
+    BrlockInit(&System.lock);
 }
 
 // TODO: Pass flags to set server as a device or a directory?
@@ -234,11 +239,15 @@ int32_t ServerInstall(int32_t chid, const char *path)
 	// Get running process
 	process_t *process = SchedGetRunningProcess();
 
+	// The channel can be destroyed by another task
+	RcuReadLock();
+
 	// Get Channel
 	channel_t *channel = (channel_t*)VectorPeek(&process->channels, chid);
 
 	if((channel == NULL) || (channel->server != NULL))
 	{
+		RcuReadUnlock();
 		return E_BUSY;
 	}
 
@@ -248,12 +257,13 @@ int32_t ServerInstall(int32_t chid, const char *path)
 	// Last character has to be different from '/' but first character has to be '/'
 	if((path[0] != '/') || (path[length - 1] == '/'))
 	{
+		RcuReadUnlock();
 		return E_INVAL;
 	}
 
 	// We will be modifying the system path so lock it
 	uint32_t status;
-	WriteLock(&System.lock, &status);
+	BrWriteLock(&System.lock, &status);
 
     // Get the last name space in the specified path
     char *remaining;
@@ -263,7 +273,8 @@ int32_t ServerInstall(int32_t chid, const char *path)
     // The path is invalid
     if(*remaining == 0)
     {
-    	WriteUnlock(&System.lock, &status);
+    	BrWriteUnlock(&System.lock, &status);
+    	RcuReadUnlock();
         return E_INVAL;
     }
 
@@ -284,21 +295,27 @@ int32_t ServerInstall(int32_t chid, const char *path)
     // At this point we only have the name of the server left
     channel->server = AddServer(parent,remaining, chid, process->pid, 0);
 
-    WriteUnlock(&System.lock, &status);
+    BrWriteUnlock(&System.lock, &status);
+
+    RcuReadUnlock();
 
-	return channel->chid;
+	return chid;
 }
 
 // TODO: Channel could have a flag to check if we close server the channel also dies
 // set when we create the server
 int32_t ker_ServerTerminate(process_t *process, int32_t chid)
 {
+	// The channel can be destroyed by another task
+	RcuReadLock();
+
 	// Get Channel
 	channel_t *channel = (channel_t*)VectorPeek(&process->channels, chid);
 
 	// Did we get a valid channel with a active server
 	if(channel == NULL || channel->server == NULL)
 	{
+		RcuReadUnlock();
 		return E_INVAL;
 	}
 
@@ -334,12 +351,14 @@ int32_t ker_ServerTerminate(process_t *process, int32_t chid)
 
 	// We will be modifying the system path so lock it
 	uint32_t status;
-	WriteLock(&System.lock, &status);
+	BrWriteLock(&System.lock, &status);
 
 	// Remove server from system namespace
 	ServerRemove(server);
 
-	WriteUnlock(&System.lock, &status);
+	BrWriteUnlock(&System.lock, &status);
+
+	RcuReadUnlock();
 
 	kfree(server, sizeof(*server) + server->len);
 
@@ -368,7 +387,7 @@ int32_t ServerConnect(const char *path)
     }
 
 	// We will Only read so lock it for reading
-	ReadLock(&System.lock);
+	BrReadLock(&System.lock);
 
     // First we need to find the name space where the server is registered
     char *remaining;
@@ -377,7 +396,7 @@ int32_t ServerConnect(const char *path)
     if(remaining == NULL)
     {
         // Nothing left to search for a server
-    	ReadUnlock(&System.lock);
+    	BrReadUnlock(&System.lock);
         return -1;
     }
 
@@ -386,7 +405,7 @@ int32_t ServerConnect(const char *path)
         if(remaining[length] == '/')
         {
             // We couldn't resolve the whole path
-        	ReadUnlock(&System.lock);
+        	BrReadUnlock(&System.lock);
             return -1;
         }
     }
@@ -401,7 +420,7 @@ int32_t ServerConnect(const char *path)
         }
     }
 
-    ReadUnlock(&System.lock);
+    BrReadUnlock(&System.lock);
 
     // If we didn't found the server
     if(server == NULL)
@@ -424,11 +443,15 @@ int32_t ServerDisconnect(int32_t coid)
 	// Get running process
 	process_t *process = SchedGetRunningProcess();
 
+	// Another task of the process can be detaching it
+	RcuReadLock();
+
 	// Get connection
 	clink_t* connection = (clink_t*)VectorPeek(&process->connections, (uint32_t)coid);
 
 	if(connection == NULL/* || !(connection->flags & CONNECTION_SERVER_BONDED)*/)
 	{
+		RcuReadUnlock();
 		// Nothing to be done
 		return E_INVAL;
 	}
@@ -447,7 +470,11 @@ int32_t ServerDisconnect(int32_t coid)
 	}
 #endif
 	// The connection is bound to the sever we have to terminate it
-	return ker_ConnectDetach(process, connection, FALSE);
+	int32_t ret = ker_ConnectDetach(process, connection, FALSE);
+
+	RcuReadUnlock();
+
+	return ret;
 }
 
 uint32_t NameSpaceCopy(nentry_t *entry, namespace_t *namespace)
@@ -529,17 +556,43 @@ typedef struct
 	uint32_t ramavailable;
 	uint32_t ramusage;
 	uint32_t runningprocs;
+	uint32_t heapsize;
+	uint32_t heapreleased;
+	uint32_t tlbrefills;
+	uint32_t vsswitches;
+	uint32_t vsskips;
+	uint32_t vsswitchcycles;
+	uint32_t mtxspins;
+	uint32_t mtxspinwins;
 }sysinfo_t;
 
 int32_t SystemReadStats(char *buffer, size_t size, uint32_t *offset)
 {
-	if(size < sizeof(sysinfo_t))
+	// Older clients know fewer fields, each tier is only filled when the record has room for it
+	uint32_t tiers[] =
 	{
-		if(offset != NULL)
-		{
-			*offset = 0;
-		}
+		offsetof(sysinfo_t, heapsize),
+		offsetof(sysinfo_t, tlbrefills),
+		offsetof(sysinfo_t, vsswitches),
+		offsetof(sysinfo_t, mtxspins),
+		sizeof(sysinfo_t)
+	};
+	uint32_t filled = 0;
+	uint32_t i;
+
+	for(i = 0; (i < (sizeof(tiers) / sizeof(tiers[0]))) && (size >= tiers[i]); i++)
+	{
+		filled = tiers[i];
+	}
 
+	if(offset != NULL)
+	{
+		*offset = filled;
+	}
+
+	// Not even the memory and processes fields fit
+	if(filled == 0)
+	{
 		return E_ERROR;
 	}
 
@@ -549,9 +602,25 @@ int32_t SystemReadStats(char *buffer, size_t size, uint32_t *offset)
 	sysinfo->ramusage = RamGetUsage();
 	sysinfo->runningprocs = ProcProcessesRunning();
 
-	if(offset != NULL)
+	if(filled > offsetof(sysinfo_t, heapsize))
 	{
-		*offset = sizeof(sysinfo_t);
+		sysinfo->heapsize = kheapGetSize();
+		sysinfo->heapreleased = kheapGetReleased();
+	}
+
+	if(filled > offsetof(sysinfo_t, tlbrefills))
+	{
+		sysinfo->tlbrefills = SchedGetTlbRefills();
+	}
+
+	if(filled > offsetof(sysinfo_t, vsswitches))
+	{
+		SchedGetSwitchStats(&sysinfo->vsswitches, &sysinfo->vsskips, &sysinfo->vsswitchcycles);
+	}
+
+	if(filled > offsetof(sysinfo_t, mtxspins))
+	{
+		MutexGetSpinStats(&sysinfo->mtxspins, &sysinfo->mtxspinwins);
 	}
 
 	return E_OK;
@@ -563,6 +632,21 @@ int32_t SystemReceive(const io_hdr_t *hdr, const char *obuff, const char *ibuff,
 
 	if(hdr->type == _IO_READ)
 	{
+		if(hdr->code == READ_IRQ_LATENCY)
+		{
+			return LatencyRead((char*)ibuff, hdr->rbytes, offset);
+		}
+
+		if(hdr->code == READ_LOCK_STATS)
+		{
+			return KlockStatsRead((char*)ibuff, hdr->rbytes, offset);
+		}
+
+		if(hdr->code == READ_HRTIMER_JITTER)
+		{
+			return HrtimerJitterRead((char*)ibuff, hdr->rbytes, offset);
+		}
+
 		return SystemReadStats((char*)ibuff, hdr->rbytes, offset);
 	}
 
@@ -571,7 +655,7 @@ int32_t SystemReceive(const io_hdr_t *hdr, const char *obuff, const char *ibuff,
 		return E_INVAL;
 	}
 
-	ReadLock(&System.lock);
+	BrReadLock(&System.lock);
 
 	char *remaining = NULL;
 	namespace_t *parent = PathResolve(obuff, &remaining);
@@ -581,6 +665,7 @@ int32_t SystemReceive(const io_hdr_t *hdr, const char *obuff, const char *ibuff,
 		if(!((hdr->code == INFO_NAMESPACE_LS) || (hdr->code == INFO_BEST_MATCH)))
 		{
 			// Not allowed operation. We can only request entries information to namespaces
+			BrReadUnlock(&System.lock);
 			return E_INVAL;
 		}
 
@@ -604,7 +689,7 @@ int32_t SystemReceive(const io_hdr_t *hdr, const char *obuff, const char *ibuff,
 		else if((hdr->code == INFO_NAMESPACE_LS))
 		{
 			// Namespace list is not supported if there is more than one entry in the path
-			ReadUnlock(&System.lock);
+			BrReadUnlock(&System.lock);
 			return E_INVAL;
 		}
 
@@ -614,14 +699,14 @@ int32_t SystemReceive(const io_hdr_t *hdr, const char *obuff, const char *ibuff,
 		if(server == NULL)
 		{
 			// We didn't found a server so there is no way to solve the path
-			ReadUnlock(&System.lock);
+			BrReadUnlock(&System.lock);
 			return E_INVAL;
 		}
 
 		sentry_t *sentry = (sentry_t *)ibuff;
 		uint32_t entrybytes = ServerEntryCopy(sentry, server);
 
-		ReadUnlock(&System.lock);
+		BrReadUnlock(&System.lock);
 
 		if(slashs == TRUE)
 		{
@@ -644,7 +729,7 @@ int32_t SystemReceive(const io_hdr_t *hdr, const char *obuff, const char *ibuff,
 		nentry_t *nentry = (nentry_t *)ibuff;
 		uint32_t entrybytes = NameSpaceCopy(nentry, parent);
 
-		ReadUnlock(&System.lock);
+		BrReadUnlock(&System.lock);
 
 		if(offset != NULL)
 		{
@@ -656,7 +741,7 @@ int32_t SystemReceive(const io_hdr_t *hdr, const char *obuff, const char *ibuff,
 
 	uint32_t entrybytes = NameSpaceCopyEntry((void*)ibuff, hdr->code, parent);
 
-	ReadUnlock(&System.lock);
+	BrReadUnlock(&System.lock);
 
 	// If no bytes where copied the entry was not valid
 	if(entrybytes == 0)
@@ -72,6 +72,7 @@ int32_t TaskInit(task_t *task, taskAttr_t *attr, taskParam_t *param)
 	// Set task info
 	task->state = READY;
 	task->active_prio = task->real_prio = attr->priority;
+	task->rcuNest = 0;
 	if(attr->detached) task->flags |= TASK_DETACHED;
 
 	// We do not set any privilege level at task creation because all tasks are
@@ -106,6 +107,9 @@ int32_t TaskInit(task_t *task, taskAttr_t *attr, taskParam_t *param)
 	task->interrupt.id  = INTERRUPT_INVALID;
 	task->interrupt.irq = INTERRUPT_INVALID;
 
+	// High resolution timeout not started
+	memset(&task->timeout.hrtimer, 0x0, sizeof(hrtimer_t));
+
 	return E_OK;
 }
 
@@ -10,6 +10,8 @@
 #include <vector.h>
 #include <string.h>
 #include <kheap.h>
+#include <rcu.h>
+#include <asm.h>
 
 
 /* Private types ------------------------------------------ */
@@ -54,6 +56,27 @@ static inline void *GetPtr(entry_t *entry)
 	return (void *)((uint32_t)entry & ~0x1);
 }
 
+// The array capacity is kept in the word before it, lockless readers get both from one load
+static inline void **DataAlloc(uint32_t size)
+{
+	uint32_t *block = (uint32_t*)kmalloc((size + 1) * sizeof(void *));
+
+	if(block == NULL)
+	{
+		return NULL;
+	}
+
+	block[0] = size;
+
+	return (void**)&block[1];
+}
+
+static inline void DataRelease(void **data, uint32_t size)
+{
+	// Readers can still be going through it
+	RcuFree(&((uint32_t*)data)[-1], (size + 1) * sizeof(void *));
+}
+
 /* Private variables -------------------------------------- */
 
 
@@ -80,7 +103,12 @@ int32_t VectorInit(vector_t *vector, uint32_t size)
         size = VECTOR_MIN_SIZE;
     }
 
-    vector->data = (void**)kmalloc((size + 1) * sizeof(void *));
+    vector->data = DataAlloc(size + 1);
+
+    if(vector->data == NULL)
+    {
+        return E_NO_MEMORY;
+    }
 
     vector->free = Ptr2Entry(vector->data);
 
@@ -129,9 +157,14 @@ int32_t VectorExpand(vector_t *vector, uint32_t size)
         newSize = VECTOR_MAX_SIZE;
     }
 
-    void *newData = kmalloc(newSize * sizeof(void *));
+    void **newData = DataAlloc(newSize);
 
-    void *oldData = (void*)vector->data;
+    if(newData == NULL)
+    {
+        return -1;
+    }
+
+    void **oldData = vector->data;
 
     memcpy(newData, oldData, vector->size * sizeof(void *));
 
@@ -152,17 +185,13 @@ int32_t VectorExpand(vector_t *vector, uint32_t size)
     }
     else
     {
-        vector->free = Ptr2Entry(&((void**)newData)[vector->size]);
+        vector->free = Ptr2Entry(&newData[vector->size]);
         prev = EntryGet(vector->free);
     }
 
-    vector->data = (void**)newData;
-
-    kfree(oldData, vector->size);
-
     int32_t i = 0;
 
-    entry_t *entry = Ptr2Entry(&vector->data[vector->size]);
+    entry_t *entry = Ptr2Entry(&newData[vector->size]);
 
     // If prev is equal to entry we already have free pointing to the
     // first slot in the expanded part of the vector
@@ -172,7 +201,7 @@ int32_t VectorExpand(vector_t *vector, uint32_t size)
         i = 1;
     }
 
-    for(i = 0; i < (newSize - vector->size - 1); i++)
+    for(; i < (newSize - vector->size); i++)
     {
         prev->next = EntrySet((void*)entry);
         prev = EntryGetNext(prev);
@@ -180,6 +209,12 @@ int32_t VectorExpand(vector_t *vector, uint32_t size)
     }
     prev->next = EntrySet(NULL);
 
+    // New entries have to be seen initialized by readers finding the new array
+    dmb();
+    vector->data = newData;
+
+    DataRelease(oldData, vector->size);
+
     vector->nfree += newSize - vector->size;
     vector->size = newSize;
 
@@ -260,7 +295,7 @@ int32_t VectorInsertAt(vector_t *vector, void *obj, uint32_t index)
 */
 void *VectorRemove(vector_t *vector, unsigned index)
 {
-    if(vector == NULL || vector->size < index)
+    if(vector == NULL || vector->size <= index)
     {
         return NULL;
     }
@@ -287,12 +322,23 @@ void *VectorRemove(vector_t *vector, unsigned index)
 */
 void *VectorPeek(vector_t *vector, uint32_t index)
 {
-	if(vector == NULL || vector->size < index)
+	if(vector == NULL)
 	{
 		return NULL;
 	}
 
-	return (((uint32_t)vector->data[index] & 0x1) ? (NULL): (vector->data[index]));
+	// No lock, the array can be replaced or freed meanwhile so it is only read once.
+	// The capacity and entry loads depend on it and can't see an older array
+	void **data = ((volatile vector_t *)vector)->data;
+
+	if((data == NULL) || (((uint32_t*)data)[-1] <= index))
+	{
+		return NULL;
+	}
+
+	void *ptr = ((void * volatile *)data)[index];
+
+	return (((uint32_t)ptr & 0x1) ? (NULL) : (ptr));
 }
 
 /**
@@ -318,7 +364,7 @@ void VectorFree(vector_t *vector)
 {
 	if(vector->data)
 	{
-		kfree(vector->data, vector->size);
+		DataRelease(vector->data, vector->size);
 	}
 	memset(vector, 0x0, sizeof(vector_t));
 }
@@ -1,7 +1,7 @@
 /**
  * @file        buddy.c
  * @author      Carlos Fernandes
- * @version     3.0
+ * @version     4.0
  * @date        02 September, 2020
  * @brief       Buddy system implementation
 */
@@ -10,6 +10,9 @@
 #include <buddy.h>
 #include <kheap.h>
 #include <string.h>
+#include <spinlock.h>
+#include <arch.h>
+#include <misc.h>
 
 
 /* Private types ------------------------------------------ */
@@ -17,9 +20,21 @@
 
 /* Private constants -------------------------------------- */
 
+#define PAGE_SHIFT			(12)
+
+// Order 0 pages moved between the per cpu hot list and the buddy at once
+#define BUDDY_HOT_BATCH		(8)
+
+// Hot list size above which pages are given back to the buddy
+#define BUDDY_HOT_HIGH		(32)
+
 
 /* Private macros ----------------------------------------- */
 
+#define BLOCK_SIZE(order)			(PAGE_SIZE << (order))
+
+#define BLOCK_INDEX(b, addr, order)	\
+		(((uint32_t)(addr) - (uint32_t)(b)->origin) >> (PAGE_SHIFT + (order)))
 
 
 /* Private variables -------------------------------------- */
@@ -64,25 +79,46 @@ uint32_t GetMaxOrder(uint32_t size)
 	return count;
 }
 
-ptr_t BlockGet(mBlock_t **Blocks, uint32_t order)
+/*
+ * @brief   Per order bitmap helpers. A set bit means the block with that
+ * 			index is the head of a free block of that order
+ */
+static inline bool_t BitTest(buddy_t *buddy, uint32_t index, uint32_t order)
 {
-	if(Blocks[order] != NULL)
+	if(index >= buddy->blocks[order])
 	{
-		// Remove Head
-		ptr_t addr = (ptr_t)Blocks[order];
-		Blocks[order] = Blocks[order]->next;
-		if(Blocks[order]) { Blocks[order]->prev = NULL; }
-		return addr;
+		return FALSE;
 	}
 
-	return NULL;
+	return ((buddy->bitmap[order][index >> 5] & (1UL << (index & 0x1F))) ? TRUE : FALSE);
+}
+
+static inline void BitSet(buddy_t *buddy, uint32_t index, uint32_t order)
+{
+	buddy->bitmap[order][index >> 5] |= (1UL << (index & 0x1F));
+}
+
+static inline void BitClear(buddy_t *buddy, uint32_t index, uint32_t order)
+{
+	buddy->bitmap[order][index >> 5] &= ~(1UL << (index & 0x1F));
 }
 
-void BlockRemove(mBlock_t **Blocks, mBlock_t *mBlock, uint32_t order)
+static void BlockPush(buddy_t *buddy, mBlock_t *mBlock, uint32_t order)
+{
+	mBlock->prev = NULL;
+	mBlock->next = buddy->mBlocks[order];
+	if(mBlock->next != NULL) { mBlock->next->prev = mBlock; }
+	buddy->mBlocks[order] = mBlock;
+
+	BitSet(buddy, BLOCK_INDEX(buddy, mBlock, order), order);
+	buddy->freeBlocks[order]++;
+}
+
+void BlockRemove(buddy_t *buddy, mBlock_t *mBlock, uint32_t order)
 {
 	if(mBlock->prev == NULL)
 	{
-		Blocks[order] = mBlock->next;
+		buddy->mBlocks[order] = mBlock->next;
 	}
 	else
 	{
@@ -94,151 +130,130 @@ void BlockRemove(mBlock_t **Blocks, mBlock_t *mBlock, uint32_t order)
 		mBlock->next->prev = mBlock->prev;
 	}
 
-
 	mBlock->next = NULL;
 	mBlock->prev = NULL;
+
+	BitClear(buddy, BLOCK_INDEX(buddy, mBlock, order), order);
+	buddy->freeBlocks[order]--;
 }
 
-bool_t IsBuddy(ptr_t left, ptr_t right, uint32_t order)
+/*
+ * @brief   Takes a block of the requested order splitting the first bigger
+ * 			free block when needed. Called with the buddy lock held
+ * @param  	buddy - buddy system handler
+ * 			order - block order
+ * @retval  Block address or NULL if there is no memory available
+ */
+ptr_t BlockGet(buddy_t *buddy, uint32_t order)
 {
-	// Left has to be order + 1 aligned
-	if(GetOrder((uint32_t)left) <= order)
+	uint32_t current = order;
+
+	while(current <= MAX_ORDER && buddy->freeBlocks[current] == 0)
 	{
-		return FALSE;
+		current++;
 	}
 
-	// left and right have to be contiguous
-	if(((uint32_t)left + (PAGE_SIZE << order)) != (uint32_t)right)
+	if(current > MAX_ORDER)
 	{
-		return FALSE;
+		return NULL;
 	}
 
-	return TRUE;
-}
-
-void BlockInsert(mBlock_t **Blocks, mBlock_t *mBlock, uint32_t order)
-{
-	// Get the first memory block with the same order
-	mBlock_t *iterator = Blocks[order];
+	mBlock_t *mBlock = buddy->mBlocks[current];
+	BlockRemove(buddy, mBlock, current);
 
-	// Handler insert Head
-	if(iterator == NULL)
+	// Give back the upper halves until we reach the requested order
+	while(current > order)
 	{
-		Blocks[order] = mBlock;
-		mBlock->next = NULL;
-		mBlock->prev = NULL;
-		return;
+		current--;
+		BlockPush(buddy, (mBlock_t*)((uint32_t)mBlock + BLOCK_SIZE(current)), current);
 	}
 
-	// Sort Insert
-	while(iterator)
+	return (ptr_t)mBlock;
+}
+
+/*
+ * @brief   Returns a block to the buddy merging it with its buddy for as
+ * 			long as the buddy is also free. Called with the buddy lock held
+ * @param  	buddy - buddy system handler
+ * 			mBlock - block to be freed
+ * 			order - block order
+ * @retval  No return
+ */
+void BlockInsertMerge(buddy_t *buddy, mBlock_t *mBlock, uint32_t order)
+{
+	while(order < MAX_ORDER)
 	{
-		// Insert back
-		if((uint32_t)iterator > (uint32_t)mBlock)
+		mBlock_t *sibling = (mBlock_t*)((uint32_t)mBlock ^ BLOCK_SIZE(order));
+
+		if(BitTest(buddy, BLOCK_INDEX(buddy, sibling, order), order) == FALSE)
 		{
-			mBlock->next = iterator;
-			mBlock->prev = iterator->prev;
-			if(iterator->prev != NULL)
-			{
-				iterator->prev->next = mBlock;
-			}
-			else
-			{
-				// Insert in the list head
-				Blocks[order] = mBlock;
-			}
-			iterator->prev = mBlock;
-			// Block is inserted return
-			return;
+			break;
 		}
-		// Insert front
-		if(iterator->next == NULL)
+
+		BlockRemove(buddy, sibling, order);
+
+		if(sibling < mBlock)
 		{
-			mBlock->next = NULL;
-			mBlock->prev = iterator;
-			iterator->next = mBlock;
-			// Block is inserted return
-			return;
+			mBlock = sibling;
 		}
-		// Advance one block
-		iterator = iterator->next;
+
+		order++;
 	}
+
+	BlockPush(buddy, mBlock, order);
 }
 
-void BlockInsertMerge(mBlock_t **Blocks, mBlock_t *mBlock, uint32_t order)
+/*
+ * @brief   Moves up to count order 0 pages from the buddy to the hot list
+ * @param  	buddy - buddy system handler
+ * 			hot - per cpu hot list
+ * 			count - number of pages
+ * @retval  No return
+ */
+static void HotRefill(buddy_t *buddy, hotList_t *hot, uint32_t count)
 {
-	// Get the first memory block with the same order
-	mBlock_t *iterator = Blocks[order];
+	uint32_t status;
+	Klock(&buddy->lock, &status);
 
-	// Handler insert Head (no merge needed)
-	if(iterator == NULL)
+	while(count--)
 	{
-		Blocks[order] = mBlock;
-		mBlock->next = NULL;
-		mBlock->prev = NULL;
-		return;
-	}
+		mBlock_t *page = (mBlock_t*)BlockGet(buddy, 0);
 
-	// Sort Insert
-	while(iterator)
-	{
-		// Insert back
-		if((uint32_t)iterator > (uint32_t)mBlock)
-		{
-			if(IsBuddy(mBlock, iterator, order) == TRUE)
-			{
-				// Remove and reinsert
-				BlockRemove(Blocks, iterator, order);
-				BlockInsertMerge(Blocks, mBlock, order + 1);
-				return;
-			}
-
-			if(iterator->prev && (IsBuddy(iterator->prev, mBlock, order) == TRUE))
-			{
-				// Remove iterator->prev and reinsert
-				mBlock_t *prev = iterator->prev;
-				BlockRemove(Blocks, prev, order);
-				BlockInsertMerge(Blocks, prev, order + 1);
-				return;
-			}
-
-			// Not a buddy so just insert
-			mBlock->next = iterator;
-			mBlock->prev = iterator->prev;
-			if(iterator->prev != NULL)
-			{
-				iterator->prev->next = mBlock;
-			}
-			else
-			{
-				// Insert in the list head
-				Blocks[order] = mBlock;
-			}
-			iterator->prev = mBlock;
-			// Block is inserted return
-			return;
-		}
-		// Insert front
-		if(iterator->next == NULL)
+		if(page == NULL)
 		{
-			if(IsBuddy(iterator, mBlock, order) == TRUE)
-			{
-				// Remove and reinsert
-				BlockRemove(Blocks, iterator, order);
-				BlockInsertMerge(Blocks, iterator, order + 1);
-				return;
-			}
-
-			// Not a buddy so just insert
-			mBlock->next = NULL;
-			mBlock->prev = iterator;
-			iterator->next = mBlock;
-			// Block is inserted return
-			return;
+			break;
 		}
-		// Advance one block
-		iterator = iterator->next;
+
+		page->next = hot->pages;
+		hot->pages = page;
+		hot->count++;
 	}
+
+	Kunlock(&buddy->lock, &status);
+}
+
+/*
+ * @brief   Gives back up to count order 0 pages from the hot list to the buddy
+ * @param  	buddy - buddy system handler
+ * 			hot - per cpu hot list
+ * 			count - number of pages
+ * @retval  No return
+ */
+static void HotDrain(buddy_t *buddy, hotList_t *hot, uint32_t count)
+{
+	uint32_t status;
+	Klock(&buddy->lock, &status);
+
+	while(count-- && hot->pages != NULL)
+	{
+		mBlock_t *page = hot->pages;
+		hot->pages = page->next;
+		hot->count--;
+
+		BlockInsertMerge(buddy, page, 0);
+	}
+
+	Kunlock(&buddy->lock, &status);
 }
 
 /* Private functions -------------------------------------- */
@@ -263,6 +278,7 @@ buddy_t *buddySystemCreate(ptr_t pAddr, ptr_t vAddr, uint32_t size, uint32_t off
 	buddy->availableMemory = size - offset;
 
 	KlockInit(&buddy->lock);
+	KlockName(&buddy->lock, "buddy");
 
 	return buddy;
 }
@@ -275,7 +291,27 @@ int32_t buddyInit(buddy_t *buddy)
 	uint32_t 	order = 0;
 	mBlock_t	*mblock = NULL;
 	uint32_t	base = (uint32_t)((uint32_t)buddy->vAddr + buddy->offset);
-	uint32_t	end = base + buddy->availableMemory;
+	uint32_t	end = (uint32_t)buddy->vAddr + buddy->size;
+
+	// Bitmaps are indexed from an address aligned to the biggest block so the
+	// buddy of any block is found by flipping the order bit of its address
+	buddy->origin = (ptr_t)ALIGN_DOWN(base, BLOCK_SIZE(MAX_ORDER));
+
+	// The bitmaps are carved from the beginning of the managed memory
+	uint32_t bitmaps = base;
+	for(order = 0; order <= MAX_ORDER; order++)
+	{
+		buddy->blocks[order] = ((end - (uint32_t)buddy->origin) >> (PAGE_SHIFT + order));
+		buddy->bitmap[order] = (uint32_t*)bitmaps;
+		bitmaps += (ROUND_UP(buddy->blocks[order], 32) >> 3);
+	}
+
+	memset((void*)base, 0x0, (bitmaps - base));
+
+	base = ALIGN_UP(bitmaps, PAGE_SIZE);
+	buddy->offset = base - (uint32_t)buddy->vAddr;
+	buddy->availableMemory = end - base;
+
 	// Determine the higher order possible to speedup map the block into the buddy system
 	while(base < end){
 		mblock = (mBlock_t*)base;
@@ -289,7 +325,7 @@ int32_t buddyInit(buddy_t *buddy)
 			base -= (PAGE_SIZE << order);
 		}
 		// Insert memory block into the buddy system
-		BlockInsertMerge(buddy->mBlocks, mblock, order);
+		BlockInsertMerge(buddy, mblock, order);
 	}
 	return 0;
 }
@@ -315,22 +351,40 @@ ptr_t buddyGetMemory(buddy_t *buddy, uint32_t size)
 		return NULL;
 	}
 
-	Klock(&buddy->lock, &status);
+	if(order == 0)
+	{
+		// Single pages come from the cpu hot list, only refills take the lock
+		critical_lock(&status);
 
-	ptr_t addr = BlockGet(buddy->mBlocks, order);
+		hotList_t *hot = &buddy->hot[RUNNING_CPU];
 
-	if(addr == NULL)
-	{
-		addr = buddyGetMemory(buddy, (size << 1));
+		if(hot->pages == NULL)
+		{
+			HotRefill(buddy, hot, BUDDY_HOT_BATCH);
+		}
+
+		mBlock_t *page = hot->pages;
 
-		if(addr == NULL)
+		if(page != NULL)
 		{
-			Kunlock(&buddy->lock, &status);
-			return NULL;
+			hot->pages = page->next;
+			hot->count--;
 		}
 
-		// Insert top half of this memory block (right buddy)
-		BlockInsert(buddy->mBlocks, (mBlock_t*)((uint32_t)addr + size), order);
+		critical_unlock(&status);
+
+		return (ptr_t)page;
+	}
+
+	Klock(&buddy->lock, &status);
+
+	ptr_t addr = BlockGet(buddy, order);
+
+	if(addr == NULL && buddy->hot[RUNNING_CPU].count > 0)
+	{
+		// Pages held in our hot list may complete a bigger block
+		HotDrain(buddy, &buddy->hot[RUNNING_CPU], BUDDY_HOT_HIGH);
+		addr = BlockGet(buddy, order);
 	}
 
 	Kunlock(&buddy->lock, &status);
@@ -344,6 +398,27 @@ ptr_t buddyGetMemory(buddy_t *buddy, uint32_t size)
 void buddyFreeMemory(buddy_t *buddy, ptr_t memory, uint32_t size)
 {
 	uint32_t status;
+
+	if(size == PAGE_SIZE)
+	{
+		critical_lock(&status);
+
+		hotList_t *hot = &buddy->hot[RUNNING_CPU];
+
+		((mBlock_t*)memory)->next = hot->pages;
+		hot->pages = (mBlock_t*)memory;
+		hot->count++;
+
+		if(hot->count > BUDDY_HOT_HIGH)
+		{
+			HotDrain(buddy, hot, BUDDY_HOT_BATCH);
+		}
+
+		critical_unlock(&status);
+
+		return;
+	}
+
 	Klock(&buddy->lock, &status);
 
 	while(size)
@@ -353,13 +428,13 @@ void buddyFreeMemory(buddy_t *buddy, ptr_t memory, uint32_t size)
 
 		if(size_order >= addr_order)
 		{
-			BlockInsertMerge(buddy->mBlocks,(mBlock_t*)memory, addr_order);
+			BlockInsertMerge(buddy, (mBlock_t*)memory, addr_order);
 			size -= (PAGE_SIZE << addr_order);
 			memory = (ptr_t)((uint32_t)memory + (PAGE_SIZE << addr_order));
 		}
 		else
 		{
-			BlockInsertMerge(buddy->mBlocks,(mBlock_t*)memory, size_order);
+			BlockInsertMerge(buddy, (mBlock_t*)memory, size_order);
 			size -= (PAGE_SIZE << size_order);
 			memory = (ptr_t)((uint32_t)memory + (PAGE_SIZE << size_order));
 		}
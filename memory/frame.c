@@ -0,0 +1,235 @@
+/**
+ * @file        frame.c
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        18 October, 2026
+ * @brief       Physical Page Frame Database Implementation file
+*/
+
+/* Includes ----------------------------------------------- */
+#include <frame.h>
+#include <memmgr.h>
+#include <mmu.h>
+#include <atomic.h>
+#include <string.h>
+#include <misc.h>
+
+
+/* Private types ------------------------------------------ */
+
+typedef struct
+{
+	uint32_t	base;
+	uint32_t	frames;
+	frame_t		*table;
+}region_t;
+
+
+/* Private constants -------------------------------------- */
+
+#define PAGE_SHIFT			(12)
+
+
+/* Private macros ----------------------------------------- */
+
+
+/* Private variables -------------------------------------- */
+
+static struct
+{
+	region_t	regions[FRAME_MAX_REGIONS];
+	uint32_t	count;
+}frameDb;
+
+
+/* Private function prototypes ---------------------------- */
+
+/*
+ * @brief	Get the first frame of a physical range and the number of frames
+ * 			of the range covered by the same table
+ */
+static frame_t *FrameRange(paddr_t paddr, size_t size, uint32_t *count)
+{
+	uint32_t addr = (uint32_t)paddr;
+	uint32_t i;
+
+	for(i = 0; i < frameDb.count; i++)
+	{
+		region_t *region = &frameDb.regions[i];
+		uint32_t index = ((addr - region->base) >> PAGE_SHIFT);
+
+		if((addr >= region->base) && (index < region->frames))
+		{
+			*count = (ROUND_UP(size, PAGE_SIZE) >> PAGE_SHIFT);
+
+			if(*count > (region->frames - index))
+			{
+				*count = (region->frames - index);
+			}
+
+			return &region->table[index];
+		}
+	}
+
+	*count = 0;
+
+	return NULL;
+}
+
+
+/* Private functions -------------------------------------- */
+
+/**
+ * FrameTableCreate Implementation (See header file for description)
+*/
+int32_t FrameTableCreate(paddr_t base, size_t size, size_t reserved)
+{
+	if(frameDb.count == FRAME_MAX_REGIONS)
+	{
+		return E_NO_RES;
+	}
+
+	uint32_t frames = (size >> PAGE_SHIFT);
+	size_t tableSize = ROUND_UP(frames * sizeof(frame_t), PAGE_SIZE);
+
+	// Zones only hand out power of two blocks, give back the tail
+	size_t block = PAGE_SIZE;
+	while(block < tableSize) block <<= 1;
+
+	frame_t *table = (frame_t*)MemoryGet(block, ZONE_DIRECT);
+
+	if(table == NULL)
+	{
+		return E_NO_MEMORY;
+	}
+
+	if(block > tableSize)
+	{
+		MemoryFree((ptr_t)((uint32_t)table + tableSize), (block - tableSize));
+	}
+
+	memset(table, 0x0, tableSize);
+
+	region_t *region = &frameDb.regions[frameDb.count];
+	region->base = (uint32_t)base;
+	region->frames = frames;
+	region->table = table;
+	frameDb.count++;
+
+	FrameAlloc(base, reserved, FRAME_RESERVED);
+	FrameAlloc((paddr_t)MemoryL2P((ptr_t)table), tableSize, FRAME_RESERVED);
+
+	return E_OK;
+}
+
+/**
+ * FrameGet Implementation (See header file for description)
+*/
+frame_t *FrameGet(paddr_t paddr)
+{
+	uint32_t count;
+
+	return FrameRange(paddr, PAGE_SIZE, &count);
+}
+
+/**
+ * FrameAlloc Implementation (See header file for description)
+*/
+void FrameAlloc(paddr_t paddr, size_t size, uint16_t flags)
+{
+	uint32_t count;
+	frame_t *frame = FrameRange(paddr, size, &count);
+
+	for(; count > 0; count--, frame++)
+	{
+		frame->refs = 1;
+		frame->mapcount = 0;
+		frame->flags = flags;
+		frame->owner = 0;
+	}
+}
+
+/**
+ * FrameRelease Implementation (See header file for description)
+*/
+bool_t FrameRelease(paddr_t paddr, size_t size)
+{
+	uint32_t count;
+	frame_t *frame = FrameRange(paddr, size, &count);
+
+	if(frame == NULL)
+	{
+		// Memory allocated before the table existed
+		return TRUE;
+	}
+
+	if(frame->flags & FRAME_RESERVED)
+	{
+		return FALSE;
+	}
+
+	if((size <= PAGE_SIZE) && (atomic_dec(&frame->refs) > 0))
+	{
+		return FALSE;
+	}
+
+	memset(frame, 0x0, count * sizeof(frame_t));
+
+	return TRUE;
+}
+
+/**
+ * FrameRef Implementation (See header file for description)
+*/
+int32_t FrameRef(paddr_t paddr)
+{
+	frame_t *frame = FrameGet(paddr);
+
+	return ((frame != NULL) ? atomic_inc(&frame->refs) : 0);
+}
+
+/**
+ * FrameSetOwner Implementation (See header file for description)
+*/
+void FrameSetOwner(paddr_t paddr, size_t size, uint16_t flags, pid_t owner)
+{
+	uint32_t count;
+	frame_t *frame = FrameRange(paddr, size, &count);
+
+	for(; count > 0; count--, frame++)
+	{
+		frame->flags = ((frame->flags & FRAME_RESERVED) | flags);
+		frame->owner = (uint16_t)owner;
+	}
+}
+
+/**
+ * FrameMap Implementation (See header file for description)
+*/
+void FrameMap(paddr_t paddr, size_t size)
+{
+	uint32_t count;
+	frame_t *frame = FrameRange(paddr, size, &count);
+
+	for(; count > 0; count--, frame++)
+	{
+		(void)atomic_inc(&frame->mapcount);
+	}
+}
+
+/**
+ * FrameUnmap Implementation (See header file for description)
+*/
+void FrameUnmap(paddr_t paddr, size_t size)
+{
+	uint32_t count;
+	frame_t *frame = FrameRange(paddr, size, &count);
+
+	for(; count > 0; count--, frame++)
+	{
+		if(frame->mapcount > 0)
+		{
+			(void)atomic_dec(&frame->mapcount);
+		}
+	}
+}
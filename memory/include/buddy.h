@@ -16,6 +16,7 @@
 /* Includes ----------------------------------------------- */
 #include <types.h>
 #include <klock.h>
+#include <arch.h>
 
 
 /* Exported types ----------------------------------------- */
@@ -25,6 +26,15 @@ typedef struct mblock
     struct mblock *prev;
 }mBlock_t;
 
+typedef struct
+{
+	mBlock_t	*pages;
+	uint32_t	count;
+}hotList_t;
+
+/* Exported constants ------------------------------------- */
+#define MAX_ORDER		10			// 4k -> 4MB
+
 typedef struct
 {
 	klock_t		lock;
@@ -33,13 +43,15 @@ typedef struct
 	uint32_t	size;
 	uint32_t	offset;
 	uint32_t	availableMemory;
-	mBlock_t	*mBlocks[11];
+	ptr_t		origin;
+	mBlock_t	*mBlocks[MAX_ORDER + 1];
+	uint32_t	*bitmap[MAX_ORDER + 1];
+	uint32_t	blocks[MAX_ORDER + 1];
+	uint32_t	freeBlocks[MAX_ORDER + 1];
+	hotList_t	hot[MAX_CPUS];
 }buddy_t;
 
 
-/* Exported constants ------------------------------------- */
-#define MAX_ORDER		10			// 4k -> 4MB
-
 #ifndef PAGE_SIZE
 	#define PAGE_SIZE		0x1000
 #endif
@@ -0,0 +1,115 @@
+/**
+ * @file        frame.h
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        18 October, 2026
+ * @brief       Physical Page Frame Database header file
+*/
+
+#ifndef FRAME_H
+#define FRAME_H
+
+
+/* Includes ----------------------------------------------- */
+#include <types.h>
+#include <mmtypes.h>
+
+
+/* Exported constants ------------------------------------- */
+
+// Frame regions, one per memory zone
+#define FRAME_MAX_REGIONS		(4)
+
+#define FRAME_RESERVED			(1 << 0)	// Kernel image, RFS and frame tables
+#define FRAME_KERNEL			(1 << 1)	// Used by the kernel (direct zone allocations)
+#define FRAME_USER				(1 << 2)	// Given to a process
+#define FRAME_SHARED			(1 << 3)	// Mapped by several processes
+
+
+/* Exported macros ---------------------------------------- */
+
+
+/* Exported types ----------------------------------------- */
+
+typedef struct
+{
+	int32_t		refs;		// References to the frame, zero when free
+	int32_t		mapcount;	// User page table entries pointing to the frame
+	uint16_t	flags;
+	uint16_t	owner;		// Process the frame was given to
+}frame_t;
+
+
+/* Exported functions ------------------------------------- */
+
+/* @brief	Routine to create the frame table of a memory region. The table
+ * 			memory is taken from the direct zones and marked as reserved
+ *
+ * @param	base		- base physical address of the region
+ * 			size		- size of the region
+ * 			reserved	- memory at the region base already in use
+ *
+ * @retval	Success
+ */
+int32_t FrameTableCreate(paddr_t base, size_t size, size_t reserved);
+
+/* @brief	Routine to get the frame descriptor of a physical address
+ *
+ * @param	paddr	- physical address
+ *
+ * @retval	Frame descriptor or NULL if the address isn't RAM
+ */
+frame_t *FrameGet(paddr_t paddr);
+
+/* @brief	Routine to mark frames as allocated with a single reference
+ *
+ * @param	paddr	- base physical address
+ * 			size	- size of the memory
+ * 			flags	- frame flags
+ *
+ * @retval	No Return
+ */
+void FrameAlloc(paddr_t paddr, size_t size, uint16_t flags);
+
+/* @brief	Routine to drop a reference to the frames. Reserved frames are
+ * 			never released and a single page only goes back to its zone
+ * 			when the last reference is dropped
+ *
+ * @param	paddr	- base physical address
+ * 			size	- size of the memory
+ *
+ * @retval	TRUE if the memory can be returned to its zone
+ */
+bool_t FrameRelease(paddr_t paddr, size_t size);
+
+/* @brief	Routine to take an extra reference to a frame
+ *
+ * @param	paddr	- physical address
+ *
+ * @retval	Number of references
+ */
+int32_t FrameRef(paddr_t paddr);
+
+/* @brief	Routine to set the owner of the frames
+ *
+ * @param	paddr	- base physical address
+ * 			size	- size of the memory
+ * 			flags	- flags to add
+ * 			owner	- owner process id
+ *
+ * @retval	No Return
+ */
+void FrameSetOwner(paddr_t paddr, size_t size, uint16_t flags, pid_t owner);
+
+/* @brief	Routines to account a user mapping of the frames
+ *
+ * @param	paddr	- base physical address
+ * 			size	- size of the memory
+ *
+ * @retval	No Return
+ */
+void FrameMap(paddr_t paddr, size_t size);
+
+void FrameUnmap(paddr_t paddr, size_t size);
+
+#endif // FRAME_H
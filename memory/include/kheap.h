@@ -24,18 +24,22 @@
 /* Exported constants ------------------------------------- */
 #define KHEAP_DEFAULT_SIZE      4096
 
+// Objects cached per cpu and size class before going back to the slabs
+#define KHEAP_MAGAZINE_SIZE     16
+
 /* Exported macros ---------------------------------------- */
 
 
 /* Exported functions ------------------------------------- */
 
 /*
- * @brief   Initializes kernel heap with the specified size
- * @param   size - Kernel heap initial size
- *          grow - Grow rate
+ * @brief   Initializes the kernel heap size classes. Objects up to 1KB are
+ *          served from page sized slabs of power of two size classes, bigger
+ *          requests go directly to the page allocator
+ * @param   size - Memory used to prime the smaller size classes
  * @retval  Success
  */
-int32_t kheapInit(size_t size, size_t grow);
+int32_t kheapInit(size_t size);
 
 /**
  * @brief   Allocates a block of size bytes of memory
@@ -53,6 +57,28 @@ ptr_t kmalloc(size_t size);
  */
 void kfree(ptr_t ptr, size_t size);
 
+/**
+ * @brief   Returns every empty slab to the page allocator. Used when the
+ *          system is running out of memory
+ * @param   No parameters
+ * @retval  Number of bytes returned
+ */
+size_t kheapShrink();
+
+/**
+ * @brief   Memory currently held by the kernel heap slabs
+ * @param   No parameters
+ * @retval  Size in bytes
+ */
+size_t kheapGetSize();
+
+/**
+ * @brief   Memory given back by the kernel heap since boot
+ * @param   No parameters
+ * @retval  Size in bytes
+ */
+size_t kheapGetReleased();
+
 #ifdef __cplusplus
     }
 #endif
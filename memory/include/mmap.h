@@ -44,6 +44,7 @@ typedef struct
 	mbv_t*      memory;
 	memCfg_t*   memcfg;
 	int32_t     parts;
+	uint32_t    flags;
 }pobj_t;
 
 // Shared memory object
@@ -84,6 +85,9 @@ typedef struct
 
 /* Exported constants ------------------------------------- */
 
+// Private object pages are only allocated on first access (one mbv_t per page)
+#define POBJ_ONDEMAND		(1 << 0)
+
 
 
 /* Exported macros ---------------------------------------- */
@@ -112,6 +112,19 @@ int32_t vManagerSetUnmapHandler(vManager_t *vm, void *arg, int32_t (*unmapHandle
  */
 vSpace_t *vSpaceReserve(vManager_t *vm, size_t size);
 
+/* @brief	Routine to reserve a virtual space with the specified size and
+ * 			base address alignment. Used to let the memory mapped into it
+ * 			use large pages. If there is no aligned space left the base
+ * 			alignment is not guaranteed
+ *
+ * @param	vm		- Pointer to the Virtual Space Manager
+ * 			size	- Size of the virtual space being reserved
+ * 			align	- Base address alignment
+ *
+ * @retval	Pointer to the virtual space handler
+ */
+vSpace_t *vSpaceReserveAligned(vManager_t *vm, size_t size, size_t align);
+
 /* @brief	Routine to release a virtual space. All memory mapped in this virtual space
  * 			will be unmaped
  *
@@ -27,6 +27,7 @@ enum
 	PAGE_USER_TEXT,
 	PAGE_USER_DATA,
 	PAGE_USER_DEVICE,
+	PAGE_USER_COW,
 	PAGE_FAULT,
 	PAGE_CUSTOM
 };
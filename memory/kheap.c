@@ -1,7 +1,7 @@
 /**
  * @file        kheap.c
  * @author      Carlos Fernandes
- * @version     2.0
+ * @version     3.0
  * @date        16 November, 2020
  * @brief       Kernel Heap source file
 */
@@ -10,32 +10,72 @@
 #include <kheap.h>
 #include <memmgr.h>
 #include <klock.h>
+#include <spinlock.h>
+#include <arch.h>
+#include <misc.h>
 
 
 /* Private types ------------------------------------------ */
 
-typedef struct HeapBlock heapBlock_t;
+typedef struct Slab slab_t;
 
-struct HeapBlock
+/*
+ * Slab header, lives at the beginning of every slab page. Objects are
+ * carved from the rest of the page and free ones are linked through
+ * their first word.
+ */
+struct Slab
 {
-    size_t       size;
-    heapBlock_t* next;
+    slab_t*  next;
+    slab_t*  prev;
+    ptr_t    free;
+    uint16_t sclass;
+    uint16_t inuse;
 };
 
+/*
+ * Per CPU cache of free objects of a single size class. Only touched by
+ * the owner cpu with interrupts disabled so it doesn't need a lock.
+ */
+typedef struct
+{
+    uint32_t count;
+    ptr_t    objects[KHEAP_MAGAZINE_SIZE];
+}magazine_t;
+
+typedef struct
+{
+    klock_t  lock;
+    slab_t*  partial;
+    uint32_t size;
+    uint32_t offset;
+    uint32_t objects;
+    uint32_t empty;
+    uint32_t pages;
+    uint32_t released;
+}sizeClass_t;
+
 /* Private constants -------------------------------------- */
 
+#define KHEAP_MIN_SHIFT         (3)
+#define KHEAP_MAX_SHIFT         (10)
+#define KHEAP_CLASSES           (KHEAP_MAX_SHIFT - KHEAP_MIN_SHIFT + 1)
+#define KHEAP_MAX_OBJECT        (1 << KHEAP_MAX_SHIFT)
+#define KHEAP_SLAB_SIZE         (PAGE_SIZE)
+
+// Empty slabs kept per size class, above this they go back to the zone
+#define KHEAP_EMPTY_WATERMARK   (1)
 
 /* Private macros ----------------------------------------- */
 
+#define SLAB_HEADER(ptr)        ((slab_t*)ALIGN_DOWN((uint32_t)(ptr), KHEAP_SLAB_SIZE))
 
 /* Private variables -------------------------------------- */
 
 static struct
 {
-    size_t       size;
-    size_t       grow;
-    klock_t      lock;
-    heapBlock_t* blocks;
+    sizeClass_t classes[KHEAP_CLASSES];
+    magazine_t  magazines[MAX_CPUS][KHEAP_CLASSES];
 }kheap;
 
 
@@ -51,207 +91,393 @@ uint32_t msb32(register uint32_t x)
     return(x & ~(x >> 1));
 }
 
-ptr_t HeapGrow(size_t size)
+static uint32_t SizeClass(size_t size)
 {
-    ptr_t ptr = MemoryGet(size, ZONE_DIRECT);
+    uint32_t sclass = 0;
 
-    if(ptr != NULL) kheap.size += size;
+    while((1UL << (sclass + KHEAP_MIN_SHIFT)) < size)
+    {
+        sclass++;
+    }
 
-    return ptr;
+    return sclass;
 }
 
-void BlockMerge(heapBlock_t* block, heapBlock_t* next)
+static void SlabLink(sizeClass_t* sc, slab_t* slab)
 {
-    if(((uint32_t)block + block->size) == (uint32_t)next)
-    {
-        block->size += next->size;
-        block->next = next->next;
-    }
+    slab->prev = NULL;
+    slab->next = sc->partial;
+    if(sc->partial != NULL) sc->partial->prev = slab;
+    sc->partial = slab;
 }
 
-bool_t BlockExpand(heapBlock_t* block, ptr_t addr, size_t size)
+static void SlabUnlink(sizeClass_t* sc, slab_t* slab)
 {
-    if(((uint32_t)block + block->size) == (uint32_t)addr)
-    {
-        block->size += size;
-        if(block->next != NULL) BlockMerge(block, block->next);
-        return TRUE;
-    }
+    if(slab->prev != NULL) slab->prev->next = slab->next;
+    else sc->partial = slab->next;
+
+    if(slab->next != NULL) slab->next->prev = slab->prev;
 
-    return FALSE;
+    slab->next = slab->prev = NULL;
 }
 
-void HeapBlockInsert(ptr_t addr, size_t size, heapBlock_t* test)
+/*
+ * Get a new page from the direct zone and carve it into objects of the
+ * size class. Must be called without the size class lock since under
+ * memory pressure the page allocator will try to shrink the heap
+ */
+static slab_t* SlabCreate(uint32_t sclass)
 {
-    if((test != NULL) && ((ptr_t)test < addr))
-    {
-        // Try Merge
-        if(BlockExpand(test, addr, size) == TRUE)
-        {
-            return ;
-        }
+    sizeClass_t* sc = &kheap.classes[sclass];
+    slab_t* slab = (slab_t*)MemoryGet(KHEAP_SLAB_SIZE, ZONE_DIRECT);
 
-        heapBlock_t* block = (heapBlock_t*)addr;
-        block->size = size;
-        block->next = NULL;
-        test->next = block;
-        return ;
+    if(slab == NULL)
+    {
+        return NULL;
     }
 
-    if(kheap.blocks == NULL)
+    slab->sclass = (uint16_t)sclass;
+    slab->inuse = 0;
+
+    uint32_t obj = (uint32_t)slab + sc->offset;
+    uint32_t last = obj + (sc->objects - 1) * sc->size;
+
+    slab->free = (ptr_t)obj;
+
+    for(; obj < last; obj += sc->size)
     {
-        kheap.blocks = (heapBlock_t*)addr;
-        kheap.blocks->next = NULL;
-        kheap.blocks->size = size;
-        return ;
+        *(uint32_t*)obj = obj + sc->size;
     }
+    *(uint32_t*)last = NULL;
 
-    heapBlock_t* it = kheap.blocks;
-    heapBlock_t* prev = NULL;
+    return slab;
+}
 
-    while((it != NULL) && ((uint32_t)it < (uint32_t)addr))
+/*
+ * Give the slab pages in the list back to the direct zone
+ */
+static void SlabRelease(slab_t* slab)
+{
+    while(slab != NULL)
     {
-        prev = it;
-        it = it->next;
+        slab_t* next = slab->next;
+        MemoryFree((ptr_t)slab, KHEAP_SLAB_SIZE);
+        slab = next;
     }
+}
 
-    if(it == NULL)
+/*
+ * Move up to count objects from the size class slabs into the magazine.
+ * Returns the number of objects moved
+ */
+static uint32_t MagazineFill(uint32_t sclass, magazine_t* mag, uint32_t count)
+{
+    sizeClass_t* sc = &kheap.classes[sclass];
+    uint32_t status;
+    uint32_t moved = 0;
+
+    Klock(&sc->lock, &status);
+
+    while(moved < count)
     {
-        // Try Merge
-        if(BlockExpand(prev, addr, size) == TRUE)
+        slab_t* slab = sc->partial;
+
+        if(slab == NULL)
         {
-            return ;
+            Kunlock(&sc->lock, &status);
+
+            if((slab = SlabCreate(sclass)) == NULL)
+            {
+                return moved;
+            }
+
+            Klock(&sc->lock, &status);
+            sc->pages++;
+            // Counted as empty, taking objects from it below uncounts it
+            sc->empty++;
+            SlabLink(sc, slab);
         }
 
-        prev->next = (heapBlock_t*)addr;
-        prev->next->size = size;
-        prev->next->next = NULL;
+        if(slab->inuse == 0)
+        {
+            sc->empty--;
+        }
+
+        while(moved < count && slab->free != NULL)
+        {
+            mag->objects[mag->count++] = slab->free;
+            slab->free = (ptr_t)(*(uint32_t*)slab->free);
+            slab->inuse++;
+            moved++;
+        }
+
+        if(slab->free == NULL)
+        {
+            // Slab is full, it will be linked back when an object returns
+            SlabUnlink(sc, slab);
+        }
     }
-    else
+
+    Kunlock(&sc->lock, &status);
+
+    return moved;
+}
+
+/*
+ * Return count objects from the magazine top to their slabs
+ */
+static void MagazineFlush(uint32_t sclass, magazine_t* mag, uint32_t count)
+{
+    sizeClass_t* sc = &kheap.classes[sclass];
+    slab_t* release = NULL;
+    uint32_t status;
+
+    Klock(&sc->lock, &status);
+
+    while(count-- && mag->count)
     {
-        if((prev != NULL) && (BlockExpand(prev, addr, size) == TRUE))
+        ptr_t obj = mag->objects[--mag->count];
+        slab_t* slab = SLAB_HEADER(obj);
+
+        if(slab->free == NULL)
+        {
+            SlabLink(sc, slab);
+        }
+
+        *(uint32_t*)obj = (uint32_t)slab->free;
+        slab->free = obj;
+
+        if(--slab->inuse == 0)
         {
-            return ;
+            if(sc->empty < KHEAP_EMPTY_WATERMARK)
+            {
+                sc->empty++;
+                continue;
+            }
+
+            // Enough empty slabs cached, this one goes back to the zone
+            SlabUnlink(sc, slab);
+            slab->next = release;
+            release = slab;
+            sc->pages--;
+            sc->released++;
         }
+    }
+
+    Kunlock(&sc->lock, &status);
+
+    SlabRelease(release);
+}
+
+/*
+ * Requests bigger than the biggest size class go straight to the page
+ * allocator. The buddy only deals with power of two blocks so the tail
+ * beyond the page rounded size is given back right away
+ */
+static ptr_t LargeGet(size_t size)
+{
+    size = ROUND_UP(size, PAGE_SIZE);
 
-        heapBlock_t* temp = (heapBlock_t*)addr;
-        temp->size = size;
-        temp->next = it;
+    size_t block = msb32(size);
+    if(block < size) block <<= 1;
 
-        if(prev == NULL) kheap.blocks = temp;
-        else prev->next = temp;
+    ptr_t ptr = MemoryGet(block, ZONE_DIRECT);
 
-        BlockMerge(temp, it);
+    if(ptr != NULL && block > size)
+    {
+        MemoryFree((ptr_t)((uint32_t)ptr + size), (block - size));
     }
+
+    return ptr;
 }
 
 
 /* Private functions -------------------------------------- */
 
-int32_t kheapInit(size_t size, size_t grow)
+int32_t kheapInit(size_t size)
 {
-    kheap.size = 0;
-    kheap.grow = grow;
-    kheap.blocks = NULL;
-    kheap.blocks = (heapBlock_t*)HeapGrow(size);
-    kheap.blocks->size = kheap.size;
-    kheap.blocks->next = NULL;
+    uint32_t sclass;
+    uint32_t cpu;
+    size_t primed = 0;
+
+    for(sclass = 0; sclass < KHEAP_CLASSES; sclass++)
+    {
+        sizeClass_t* sc = &kheap.classes[sclass];
+
+        sc->size = (1UL << (sclass + KHEAP_MIN_SHIFT));
+        sc->offset = ROUND_UP(sizeof(slab_t), sc->size);
+        sc->objects = (KHEAP_SLAB_SIZE - sc->offset) / sc->size;
+        sc->partial = NULL;
+        sc->empty = 0;
+        sc->pages = 0;
+        sc->released = 0;
+        KlockInit(&sc->lock);
+        KlockName(&sc->lock, "kheap");
+
+        for(cpu = 0; cpu < MAX_CPUS; cpu++)
+        {
+            kheap.magazines[cpu][sclass].count = 0;
+        }
+    }
+
+    // Prime the smaller size classes, they take most of the early allocations
+    for(sclass = 0; sclass < KHEAP_CLASSES && primed < size; sclass++, primed += KHEAP_SLAB_SIZE)
+    {
+        sizeClass_t* sc = &kheap.classes[sclass];
+        slab_t* slab = SlabCreate(sclass);
 
-    KlockInit(&kheap.lock);
+        if(slab == NULL)
+        {
+            break;
+        }
+
+        sc->pages++;
+        sc->empty++;
+        SlabLink(sc, slab);
+    }
 
     return E_OK;
 }
 
 ptr_t kmalloc(size_t size)
 {
-	if(kheap.grow == 0) return NULL;
+    if(kheap.classes[0].objects == 0) return NULL;
 
-    if(size < sizeof(heapBlock_t))
+    if(size > KHEAP_MAX_OBJECT)
     {
-        size = sizeof(heapBlock_t);
-    }
-    else if(size & 0x03)
-    {
-    	// Ensure 4 bit alignment
-    	size = ((size & 0xFFFFFFFC) + 0x4);
+        return LargeGet(size);
     }
 
-    uint32_t status;
-    Klock(&kheap.lock, &status);
+    uint32_t sclass = SizeClass(size);
+    uint32_t state;
 
-    heapBlock_t* it = kheap.blocks;
-    heapBlock_t* prev = NULL;
+    critical_lock(&state);
 
-//    while((it != NULL) && (it->size < (size + sizeof(heapBlock_t))))
-    while((it != NULL) && (it->size < size))
-    {
-        prev = it;
-        it = it->next;
-    }
+    magazine_t* mag = &kheap.magazines[RUNNING_CPU][sclass];
 
-    if(it == NULL)
+    if(mag->count == 0)
     {
-        // No big enough block available, try fetch more memory
-        size_t grow = kheap.grow;
+        // Running short on pages the fill can shrink the heap, which flushes
+        // this same magazine, only what is left in it counts
+        (void)MagazineFill(sclass, mag, KHEAP_MAGAZINE_SIZE / 2);
 
-        if(size > (kheap.grow - sizeof(heapBlock_t)))
+        if(mag->count == 0)
         {
-            grow = msb32(size << 1);
-        }
+            critical_unlock(&state);
 
-        ptr_t ptr = HeapGrow(grow);
+            return NULL;
+        }
+    }
 
-        if(ptr == NULL)
-        {
-        	Kunlock(&kheap.lock, &status);
+    ptr_t ptr = mag->objects[--mag->count];
 
-        	return NULL;
-        }
+    critical_unlock(&state);
 
-        HeapBlockInsert(ptr, (grow - size), prev);
+    return ptr;
+}
 
-        Kunlock(&kheap.lock, &status);
+void kfree(ptr_t ptr, size_t size)
+{
+    if(ptr == NULL) return;
 
-        return (ptr_t)((uint32_t)ptr + (grow - size));
+    if(size > KHEAP_MAX_OBJECT)
+    {
+        MemoryFree(ptr, ROUND_UP(size, PAGE_SIZE));
+        return;
     }
 
-    if(it->size < (size + sizeof(heapBlock_t)))
+    // The slab knows the real size class, don't trust the caller size
+    uint32_t sclass = SLAB_HEADER(ptr)->sclass;
+    uint32_t state;
+
+    critical_lock(&state);
+
+    magazine_t* mag = &kheap.magazines[RUNNING_CPU][sclass];
+
+    if(mag->count == KHEAP_MAGAZINE_SIZE)
     {
-        if(prev == NULL) kheap.blocks = it->next;
-        else prev->next = it->next;
+        MagazineFlush(sclass, mag, KHEAP_MAGAZINE_SIZE / 2);
+    }
+
+    mag->objects[mag->count++] = ptr;
 
-        Kunlock(&kheap.lock, &status);
+    critical_unlock(&state);
+}
+
+size_t kheapShrink()
+{
+    size_t released = kheapGetReleased();
+    uint32_t sclass;
+    uint32_t state;
+
+    // Flush this cpu magazines, other cpus magazines can only be touched by their owners
+    critical_lock(&state);
 
-        return (ptr_t)it;
+    for(sclass = 0; sclass < KHEAP_CLASSES; sclass++)
+    {
+        magazine_t* mag = &kheap.magazines[RUNNING_CPU][sclass];
+        MagazineFlush(sclass, mag, mag->count);
     }
-    else
+
+    critical_unlock(&state);
+
+    for(sclass = 0; sclass < KHEAP_CLASSES; sclass++)
     {
-        it->size -= size;
+        sizeClass_t* sc = &kheap.classes[sclass];
+        slab_t* release = NULL;
+        uint32_t status;
 
-        ptr_t addr = (ptr_t)((uint32_t)it + it->size);
+        Klock(&sc->lock, &status);
 
-        Kunlock(&kheap.lock, &status);
+        slab_t* slab = sc->partial;
 
-        return addr;
+        while(sc->empty > 0 && slab != NULL)
+        {
+            slab_t* next = slab->next;
+
+            if(slab->inuse == 0)
+            {
+                SlabUnlink(sc, slab);
+                slab->next = release;
+                release = slab;
+                sc->empty--;
+                sc->pages--;
+                sc->released++;
+            }
+
+            slab = next;
+        }
+
+        Kunlock(&sc->lock, &status);
+
+        SlabRelease(release);
     }
+
+    return (kheapGetReleased() - released);
 }
 
-void kfree(ptr_t ptr, size_t size)
+size_t kheapGetSize()
 {
-    if(size < sizeof(heapBlock_t))
+    size_t size = 0;
+    uint32_t sclass;
+
+    for(sclass = 0; sclass < KHEAP_CLASSES; sclass++)
     {
-        size = sizeof(heapBlock_t);
+        size += kheap.classes[sclass].pages * KHEAP_SLAB_SIZE;
     }
-    else if(size & 0x03)
-	{
-		// Ensure 4 bit alignment
-		size = ((size & 0xFFFFFFFC) + 0x4);
-	}
 
-    uint32_t status;
-    Klock(&kheap.lock, &status);
+    return size;
+}
+
+size_t kheapGetReleased()
+{
+    size_t size = 0;
+    uint32_t sclass;
 
-    HeapBlockInsert(ptr, size, NULL);
+    for(sclass = 0; sclass < KHEAP_CLASSES; sclass++)
+    {
+        size += kheap.classes[sclass].released * KHEAP_SLAB_SIZE;
+    }
 
-    Kunlock(&kheap.lock, &status);
+    return size;
 }
@@ -11,10 +11,12 @@
 #include <mmu.h>
 #include <misc.h>
 #include <zone.h>
+#include <buddy.h>
 #include <vpage.h>
 #include <kheap.h>
 #include <string.h>
 #include <rfs.h>
+#include <frame.h>
 
 
 /* Private types ------------------------------------------ */
@@ -61,6 +63,41 @@ inline static void RamDealloc(size_t size)
 	memmgr.ram.used -= size;
 }
 
+/*
+ * Get the memory from the first zone of the type that has it, indirect
+ * requests don't fall back to the direct zones
+ */
+static ptr_t ZonesGetMemory(uint32_t size, ZoneType_t type)
+{
+	ptr_t addr = NULL;
+	zone_t *zone = memmgr.zones.first;
+
+	while(zone != NULL)
+	{
+		if(zone->zoneType == type && zone->availableMemory >= size)
+		{
+			addr = zone->zoneHandler.memoryGet(zone, NULL, size);
+			if(addr)
+			{
+				zone->availableMemory -= size;
+				RamAlloc(size);
+				if(ZONE_DIRECT == zone->zoneType)
+				{
+					FrameAlloc(zone->zoneHandler.memoryL2P(zone, addr), size, FRAME_KERNEL);
+				}
+				else
+				{
+					FrameAlloc(addr, size, 0);
+				}
+				return addr;
+			}
+		}
+		zone = zone->next;
+	}
+
+	return NULL;
+}
+
 
 /* Private functions -------------------------------------- */
 
@@ -88,6 +125,7 @@ int32_t MemoryManagerInit(bootLayout_t *bootLayout)
 	uint32_t mapSize = 0;
 	int32_t cont = 0;
 	zone_t *zoneList = NULL;
+	uint32_t reserved = 0;
 
 	do{
 		cont = RfsGetRamInfo(&paddr, &size);
@@ -111,6 +149,7 @@ int32_t MemoryManagerInit(bootLayout_t *bootLayout)
 			uint32_t offset = ALIGN_UP(((uint32_t)bootLayout->rfs.base + (bootLayout->rfs.size)), PAGE_SIZE) - KERNEL_VIRTUAL_ADDRESS;
 
 			memmgr.zones.first = ZoneCreateEarly(paddr, (vaddr_t)KERNEL_VIRTUAL_ADDRESS, mapSize, offset);
+			reserved = offset;
 			zoneList = memmgr.zones.first;
 			// Update RAM statistics
 			memmgr.ram.used += offset;
@@ -126,6 +165,13 @@ int32_t MemoryManagerInit(bootLayout_t *bootLayout)
 
 	}while(cont && mappedSize < DIRECT_MEMORY_SIZE);
 
+	// Frame tables for the direct zones, the kernel image and the RFS are reserved
+	zone_t *zone = memmgr.zones.first;
+	for(; zone != NULL; zone = zone->next)
+	{
+		(void)FrameTableCreate(zone->pAddr, zone->size, ((zone == memmgr.zones.first) ? (reserved) : (0)));
+	}
+
 	// Clean any mapping used for the physical to virtual memory transition
 	(void)vPageMapMemory(
 			NULL,
@@ -136,13 +182,14 @@ int32_t MemoryManagerInit(bootLayout_t *bootLayout)
 			PAGE_FAULT, NULL);
 
 	// Initialize the kernel heap
-	kheapInit(KHEAP_DEFAULT_SIZE * 4, KHEAP_DEFAULT_SIZE);
+	kheapInit(KHEAP_DEFAULT_SIZE * 4);
 
 	// All the RAM that doesn't fit the direct memory section will be attributed to indirect memory zones
 	if(size > mapSize){
 		// If there is memory left create an indirect memory zone for it
 		zoneList->next = ZoneCreate(ZONE_INDIRECT, (ptr_t)((uint32_t)paddr + mapSize), UNMAPPED, (size - mapSize), 0x0);
 		zoneList = zoneList->next;
+		(void)FrameTableCreate(zoneList->pAddr, zoneList->size, 0);
 	}
 
 	return E_OK;
@@ -181,24 +228,57 @@ ptr_t MemoryGetAligned(size_t size, ulong_t align, ZoneType_t type)
 	size = ROUND_UP(size,PAGE_SIZE);
 	align = ROUND_UP(align,PAGE_SIZE);
 
-	// If alignment is bigger than size we get a block of memory with size == align to ensure the alignment
-	// than we cut the memory block in 2: block address + size and the rest is returned to the memory system
+	if(ZONE_DIRECT == type)
+	{
+		// Direct zones blocks are aligned to their size. Get the power of two block that
+		// covers both size and alignment and the rest is returned to the memory system
+		size_t memBlockSize = PAGE_SIZE;
+
+		while((memBlockSize < size) || (memBlockSize < align))
+		{
+			if(memBlockSize == (PAGE_SIZE << MAX_ORDER))
+			{
+				// Bigger than any direct zone block
+				return NULL;
+			}
+			memBlockSize <<= 1;
+		}
+
+		ptr_t addr = MemoryGet(memBlockSize, type);
+
+		if((NULL != addr) && (memBlockSize > size))
+		{
+			MemoryFree((ptr_t)((uint32_t)addr + size), (memBlockSize - size));
+		}
+		return addr;
+	}
 
-	size_t memBlockSize = ((align > size) ? align: size);
+	// Indirect zones hand out the first block that fits, get enough memory to find
+	// an aligned base and return the head and the tail to the memory system
+	size_t extra = align - PAGE_SIZE;
 
-	ptr_t addr = MemoryGet(memBlockSize, type);
+	ptr_t addr = ZonesGetMemory(size + extra, type);
 
 	if(NULL == addr)
 	{
-		return NULL;
+		// If there isn't enough high memory get an aligned block from the lower memory
+		// section, converted to the physical address the caller is expecting
+		addr = MemoryGetAligned(size, align, ZONE_DIRECT);
+		return ((NULL != addr) ? MemoryL2P(addr) : NULL);
 	}
 
-	if(align > size)
+	ptr_t alignAddr = (ptr_t)ALIGN_UP((uint32_t)addr, align);
+	size_t head = ((uint32_t)alignAddr - (uint32_t)addr);
+
+	if(head > 0)
 	{
-		ptr_t tempAddr = (ptr_t)((uint32_t)addr + (memBlockSize - size));
-		MemoryFree(tempAddr, (memBlockSize - size));
+		MemoryFree(addr, head);
 	}
-	return addr;
+	if(extra > head)
+	{
+		MemoryFree((ptr_t)((uint32_t)alignAddr + size), (extra - head));
+	}
+	return alignAddr;
 }
 
 /**
@@ -206,25 +286,22 @@ ptr_t MemoryGetAligned(size_t size, ulong_t align, ZoneType_t type)
 */
 ptr_t MemoryGet(uint32_t size, ZoneType_t type)
 {
-	ptr_t addr = NULL;
 	// Align to a page size
 	size = ROUND_UP(size, PAGE_SIZE);
 
-	zone_t *zone = memmgr.zones.first;
+	ptr_t addr = ZonesGetMemory(size, type);
 
-	while(zone != NULL)
+	if(addr)
 	{
-		if(zone->zoneType == type && zone->availableMemory >= size)
-		{
-			addr = zone->zoneHandler.memoryGet(zone, NULL, size);
-			if(addr)
-			{
-				zone->availableMemory -= size;
-				RamAlloc(size);
-				return addr;
-			}
-		}
-		zone = zone->next;
+		return addr;
+	}
+
+	// Under memory pressure take back the empty kernel heap slabs and try again. Sizes
+	// the direct zones buddy can't serve fail anyway, shrinking the heap won't help them
+	if((ZONE_DIRECT == type) && ((size & (size - 1)) == 0) && (size <= (PAGE_SIZE << MAX_ORDER))
+		&& (kheapShrink() != 0))
+	{
+		return MemoryGet(size, type);
 	}
 
 	if(ZONE_INDIRECT == type)
@@ -278,6 +355,13 @@ void MemoryFree(ptr_t addr, uint32_t size)
 	}
 	if(zone)
 	{
+		// Reserved and still referenced frames stay where they are
+		paddr_t paddr = ((ZONE_DIRECT == zone->zoneType) ? (zone->zoneHandler.memoryL2P(zone, addr)) : (addr));
+		if(FrameRelease(paddr, size) == FALSE)
+		{
+			return;
+		}
+
 		zone->zoneHandler.memoryFree(zone, addr, size);
         zone->availableMemory += size;
         RamDealloc(size);
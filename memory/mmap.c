@@ -17,6 +17,7 @@
 #include <rfs.h>
 #include <kheap.h>
 #include <scheduler.h>
+#include <mmu.h>
 
 
 /* Private types ------------------------------------------ */
@@ -34,6 +35,7 @@
 #define MAP_SHARED		(1 << 0)	// Changes are shared
 #define MAP_PRIVATE 	(1 << 1)	// Changes are private
 #define MAP_FIXED		(1 << 2)	// Interpret address exactly
+#define MAP_POPULATE	(1 << 3)	// Allocate and map all pages right away
 #define MAP_ANON		(1 << 5)	// Map anonymous memory not associated with any specific file
 #define MAP_ANONYMOUS	MAP_ANON
 #define MAP_PHYS		(1 << 6)	// Map physical memory
@@ -118,15 +120,29 @@ mbv_t* GetPages(size_t size, uint32_t* pages)
 	for(j = 0; j < i; j++)
 	{
 		mbv[j].size = helper[j];
-		mbv[j].data = MemoryGet(mbv[j].size, ZONE_INDIRECT);
+		mbv[j].data = NULL;
+
+		// Physically align the bigger chunks so they can be mapped with large pages
+		if(mbv[j].size >= LARGE_PAGE_SIZE)
+		{
+			size_t align = ((mbv[j].size >= SECTION_SIZE) ? (SECTION_SIZE) : (LARGE_PAGE_SIZE));
+			mbv[j].data = MemoryGetAligned(mbv[j].size, align, ZONE_INDIRECT);
+		}
+
+		if(mbv[j].data == NULL)
+		{
+			mbv[j].data = MemoryGet(mbv[j].size, ZONE_INDIRECT);
+		}
 
 		if(mbv[j].data  == NULL)
 		{
-			for(j -= 1; j >= 0; j--)
+			while(j-- > 0)
 			{
 				MemoryFree(mbv[j].data, mbv[j].size);
 			}
 
+			kfree(mbv, sizeof(mbv_t) * i);
+
 			return NULL;
 		}
 	}
@@ -224,6 +240,12 @@ vaddr_t Mmap(void* addr, size_t len, int32_t prot, uint32_t flags, int32_t fd, u
 				return NULL;
 			}
 */
+			if(!(flags & MAP_POPULATE))
+			{
+				// Only reserve the virtual space, pages are allocated on first access
+				return ProcessReservePrivMemory(process, len, MmapGetFlags(prot, flags));
+			}
+
 			uint32_t pages = 0;
 			mbv_t* mbv = GetPages(len, &pages);
 
@@ -372,6 +394,12 @@ vaddr_t ShareObject(void* addr, int32_t uscoid, uint32_t flags)
 		return NULL;
 	}
 
+	// The other side maps the physical pages directly so they all have to exist
+	if(ProcessPopulatePrivObject(process, obj) != E_OK)
+	{
+		return NULL;
+	}
+
 	sobj_t* shared = (sobj_t*)kmalloc(sizeof(sobj_t));
 	shared->refs = 1;
 	// TODO: check flags...
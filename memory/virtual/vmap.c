@@ -82,6 +82,7 @@ int32_t vManagerInitialize(vManager_t *vm, pgt_t pgt, vaddr_t vBase, vaddr_t vTo
     }
 
     KlockInit(&vm->lock);
+    KlockName(&vm->lock, "vManager");
 
     return E_OK;
 }
@@ -134,6 +135,14 @@ int32_t vManagerSetUnmapHandler(vManager_t *vm, void *arg, int32_t (*unmapHandle
  * vSpaceReserve Implementation (See header file for description)
 */
 vSpace_t *vSpaceReserve(vManager_t *vm, size_t size)
+{
+    return vSpaceReserveAligned(vm, size, PAGE_SIZE);
+}
+
+/**
+ * vSpaceReserveAligned Implementation (See header file for description)
+*/
+vSpace_t *vSpaceReserveAligned(vManager_t *vm, size_t size, size_t align)
 {
     if(!vm)
     {
@@ -155,7 +164,33 @@ vSpace_t *vSpaceReserve(vManager_t *vm, size_t size)
     uint32_t status;
     Klock(&vm->lock, &status);
 
-    vSpace->base = MemoryBlockAlloc(vm->vSpacePool, size);
+    if(align > PAGE_SIZE)
+    {
+        // Reserve enough to find an aligned base and give back the head and tail
+        size_t extra = (align - PAGE_SIZE);
+        vaddr_t block = MemoryBlockAlloc(vm->vSpacePool, size + extra);
+
+        if(block != NULL)
+        {
+            vSpace->base = (vaddr_t)ALIGN_UP((uint32_t)block, align);
+            size_t head = ((uint32_t)vSpace->base - (uint32_t)block);
+
+            if(head > 0)
+            {
+                MemoryBlockFree(vm->vSpacePool, block, head);
+            }
+            if(extra > head)
+            {
+                MemoryBlockFree(vm->vSpacePool, (vaddr_t)((uint32_t)vSpace->base + size), (extra - head));
+            }
+        }
+    }
+
+    if(vSpace->base == NULL)
+    {
+        // No aligned room left, any base will do
+        vSpace->base = MemoryBlockAlloc(vm->vSpacePool, size);
+    }
 
     if(vSpace->base == NULL)
     {
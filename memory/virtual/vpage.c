@@ -8,6 +8,8 @@
 
 /* Includes ----------------------------------------------- */
 #include <vpage.h>
+#include <memmgr.h>
+#include <cache.h>
 #include <kheap.h>
 #include <string.h>
 #include <misc.h>
@@ -34,12 +36,55 @@ static memCfg_t mem_types [] =
 		{CPOLICY_WRITEALLOC,		APOLICY_RWRO, TRUE,  TRUE,  FALSE}, // User text page
 		{CPOLICY_WRITEALLOC,		APOLICY_RWRW, TRUE,  FALSE, FALSE}, // User data page
 		{CPOLICY_DEVICE_SHARED,		APOLICY_RWRW, TRUE,  FALSE, FALSE}, // User device page
+		{CPOLICY_WRITEALLOC,		APOLICY_RORO, TRUE,  FALSE, FALSE}, // User copy on write page
 		{CPOLICY_STRONGLY_ORDERED,	APOLICY_NANA, FALSE, FALSE, FALSE}, // Fault
 };
 
 
 /* Private function prototypes ---------------------------- */
 
+static memCfg_t *vPageMemCfg(ulong_t mapType, memCfg_t *memcfg)
+{
+	return ((mapType == PAGE_CUSTOM) ? (memcfg) : (&mem_types[mapType]));
+}
+
+/*
+ * Only user mappings get code loaded at run time, global executable mappings
+ * belong to the kernel image and the direct memory that is never executed
+ * through a new mapping
+ */
+static uint32_t vPageSyncFlags(ulong_t mapType, memCfg_t *memcfg)
+{
+	if(mapType == PAGE_FAULT)
+	{
+		// We don't know what was mapped before
+		return MEMORY_SYNC_ICACHE;
+	}
+
+	memcfg = vPageMemCfg(mapType, memcfg);
+
+	return ((memcfg->executable && !memcfg->global) ? (MEMORY_SYNC_ICACHE) : (MEMORY_SYNC_TLB));
+}
+
+/*
+ * Code written through the kernel mappings has to reach the point where the
+ * instruction fetches will see it. The data cache is physically indexed so the
+ * direct memory alias can be used, otherwise clean all the cache
+ */
+static void vPageCodeClean(paddr_t pAddr, size_t size)
+{
+	ptr_t laddr = MemoryP2L(pAddr);
+
+	if(laddr != NULL)
+	{
+		CleanDcacheRange(laddr, size);
+	}
+	else
+	{
+		FlushDcache();
+	}
+}
+
 /**
  * vPageMapMemory Implementation (See header file for description)
 */
@@ -49,29 +94,31 @@ uint32_t vPageMapMemory(klock_t* lock, pgt_t pgt, paddr_t pAddr, vaddr_t vAddr,
 	paddr_t alignAddr = (ptr_t)ROUND_DOWN((uint32_t)pAddr,PAGE_SIZE);
 	uint32_t MapSize = ROUND_UP(size + (uint32_t)((uint32_t)pAddr - (uint32_t)alignAddr), PAGE_SIZE);
 
+	uint32_t flags = vPageSyncFlags(mapType, memcfg);
+
 	uint32_t status = 0;
 	if(lock != NULL) Klock(lock, &status);
 
+	if((mapType != PAGE_FAULT) && (flags & MEMORY_SYNC_ICACHE))
+	{
+		vPageCodeClean(alignAddr, MapSize);
+	}
+
 	// Chose the must appropriated function to map the memory
 	if(mapType == PAGE_FAULT)
 	{
 		// Use the unmap function to be sure that the page table entries will be set to zero
 		MemoryUnmap(pgt, vAddr, MapSize);
 	}
-	else if(mapType == PAGE_CUSTOM)
-	{
-		// Map the memory
-		MemoryMap(pgt, alignAddr, vAddr, MapSize, memcfg);
-	}
 	else
 	{
 		// Map the memory
-		MemoryMap(pgt, alignAddr, vAddr, MapSize, &mem_types[mapType]);
+		MemoryMap(pgt, alignAddr, vAddr, MapSize, vPageMemCfg(mapType, memcfg));
 	}
 
 //	MemorySynchronize();
 	uint32_t pid = ((vAddr > (vaddr_t)0x80000000) ? (0) : (-1));
-	MemoryVmaSynchronize(vAddr, size, pid);
+	MemoryVmaSynchronize(vAddr, MapSize, pid, flags);
 
 	if(lock != NULL) Kunlock(lock, &status);
 
@@ -137,7 +184,8 @@ int32_t vPageUnmap(klock_t* lock, pgt_t pgt, vPage_t *vPage, void *arg, int32_t
 	MemoryUnmap(pgt, vPage->vAddr, vPage->size);
 
 	uint32_t pid = ((vPage->vAddr > (vaddr_t)0x80000000) ? (0) : (-1));
-	MemoryVmaSynchronize(vPage->vAddr, vPage->size, pid);
+	// The whole range is invalidated at once after all entries are cleared
+	MemoryVmaSynchronize(vPage->vAddr, vPage->size, pid, vPageSyncFlags(vPage->mapType, vPage->memcfg));
 
 	if(lock != NULL) Kunlock(lock, &status);
 
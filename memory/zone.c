@@ -99,6 +99,7 @@ void ZoneInit(zone_t *zone, ptr_t pAddr, ptr_t vAddr, size_t size, uint32_t offs
 	zone->zoneHandler.memoryL2P = memoryL2P;
 	zone->zoneHandler.memoryP2L = memoryP2L;
 	KlockInit(&zone->lock);
+	KlockName(&zone->lock, "zone");
 }
 
 /**
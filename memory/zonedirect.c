@@ -76,6 +76,9 @@ int32_t ZoneDirectCreate(zoneDirect_t *zone, uint32_t offset)
 	zone->buddy = buddySystemCreate(zone->zone.pAddr,zone->zone.vAddr,zone->zone.size, offset);
 	buddyInit(zone->buddy);
 
+	// The buddy bitmaps are taken from the zone memory
+	zone->zone.availableMemory = zone->buddy->availableMemory;
+
 	return E_OK;
 }
 
@@ -94,11 +97,8 @@ int32_t ZoneDirectDestroy(zone_t *zone)
 ptr_t GetMemory(zone_t *zone, ptr_t addr, size_t size)
 {
 	(void)addr;
-	uint32_t status;
-	Klock(&zone->lock, &status);
-	ptr_t ptr = buddyGetMemory(child_ptr(zone)->buddy, size);
-	Kunlock(&zone->lock, &status);
-	return ptr;
+	// The buddy does its own locking, single pages don't even need it
+	return buddyGetMemory(child_ptr(zone)->buddy, size);
 }
 
 /**
@@ -106,8 +106,5 @@ ptr_t GetMemory(zone_t *zone, ptr_t addr, size_t size)
 */
 void FreeMemory(zone_t *zone, ptr_t memory, size_t size)
 {
-	uint32_t status;
-	Klock(&zone->lock, &status);
 	buddyFreeMemory(child_ptr(zone)->buddy, memory, size);
-	Kunlock(&zone->lock, &status);
 }